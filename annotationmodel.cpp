@@ -0,0 +1,139 @@
+#include "annotationmodel.h"
+
+#include <QFile>
+#include <QList>
+
+int ClassTable::intern(const QString &name)
+{
+    QHash<QString, int>::const_iterator it = ids.constFind(name);
+    if (it != ids.constEnd())
+        return it.value();
+    names.append(name);
+    ids.insert(name, names.size() - 1);
+    return names.size() - 1;
+}
+
+QString ClassTable::name(int id) const
+{
+    return names.value(id);
+}
+
+int ClassTable::size() const
+{
+    return names.size();
+}
+
+AnnotationModel::AnnotationModel()
+    : removed(false)
+{
+}
+
+bool AnnotationModel::isModified() const
+{
+    if (removed)
+        return true;
+    foreach (quint8 f, boxFlags) {
+        if (f & Edited)
+            return true;
+    }
+    return false;
+}
+
+void AnnotationModel::setModified(bool modified)
+{
+    removed = modified;
+    if (!modified) {
+        for (int i = 0; i < boxFlags.size(); i++)
+            boxFlags[i] &= quint8(~Edited);
+    }
+}
+
+void AnnotationModel::reserve(int boxes)
+{
+    points.reserve(4 * boxes);
+    classIds.reserve(boxes);
+    boxFlags.reserve(boxes);
+}
+
+void AnnotationModel::append(const QPoint corners[4], int classId, quint8 flags)
+{
+    for (int j = 0; j < 4; j++)
+        points.append(corners[j]);
+    classIds.append(classId);
+    boxFlags.append(flags);
+}
+
+void AnnotationModel::removeLast()
+{
+    if (isEmpty())
+        return;
+    points.resize(points.size() - 4);
+    classIds.removeLast();
+    boxFlags.removeLast();
+    removed = true;
+}
+
+void AnnotationModel::rotateLast()
+{
+    if (isEmpty())
+        return;
+    QPoint *last = points.data() + points.size() - 4;
+    QPoint first = last[0];
+    last[0] = last[1];
+    last[1] = last[2];
+    last[2] = last[3];
+    last[3] = first;
+    boxFlags.last() |= Edited;
+}
+
+void AnnotationModel::clear()
+{
+    points.clear();
+    classIds.clear();
+    boxFlags.clear();
+    removed = false;
+}
+
+bool AnnotationModel::load(const QString &fileName, ClassTable *classes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    loadData(file.readAll(), classes);
+    return true;
+}
+
+void AnnotationModel::loadData(const QByteArray &data, ClassTable *classes)
+{
+    reserve(size() + data.count('\n') + 1);
+    foreach (const QByteArray &line, data.split('\n')) {
+        QList<QByteArray> arr = line.trimmed().split(' ');
+        if (arr.size() < 9)
+            continue;
+        QPoint corners[4];
+        for (int j = 0; j < 4; j++)
+            corners[j] = QPoint(arr[1 + 2 * j].toInt(), arr[2 + 2 * j].toInt());
+        append(corners, classes->intern(QString::fromUtf8(arr[0])), 0);
+    }
+}
+
+bool AnnotationModel::save(const QString &fileName, const ClassTable &classes) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray data;
+    data.reserve(size() * 48);
+    for (int i = 0; i < size(); i++) {
+        data += classes.name(classIds[i]).toUtf8();
+        const QPoint *c = corners(i);
+        for (int j = 0; j < 4; j++) {
+            data += ' ';
+            data += QByteArray::number(c[j].x());
+            data += ' ';
+            data += QByteArray::number(c[j].y());
+        }
+        data += '\n';
+    }
+    return file.write(data) == data.size();
+}
@@ -0,0 +1,64 @@
+#ifndef ANNOTATIONMODEL_H
+#define ANNOTATIONMODEL_H
+
+#include <QHash>
+#include <QPoint>
+#include <QString>
+#include <QVector>
+
+// Interns class names so boxes only carry a small integer id.
+class ClassTable
+{
+public:
+    int intern(const QString &name);
+    QString name(int id) const;
+    int size() const;
+
+private:
+    QVector<QString> names;
+    QHash<QString, int> ids;
+};
+
+// Oriented boxes of one image stored as flat arrays: four corners per box in
+// one contiguous block, plus parallel class id and flag arrays. Flags live
+// only in memory; label files do not carry them.
+class AnnotationModel
+{
+public:
+    enum Flag {
+        Edited = 0x1,   // drawn, rotated or pushed since the labels were read
+        Predicted = 0x2 // accepted from the model's predictions
+    };
+
+    AnnotationModel();
+
+    int size() const { return classIds.size(); }
+    bool isEmpty() const { return classIds.isEmpty(); }
+    const QPoint *corners(int box) const { return points.constData() + 4 * box; }
+    int classId(int box) const { return classIds[box]; }
+    quint8 flags(int box) const { return boxFlags[box]; }
+    // Whether a box was added, edited or removed since the labels were read
+    // or last saved; untouched labels need not be written back.
+    bool isModified() const;
+    void setModified(bool modified);
+
+    void reserve(int boxes);
+    void append(const QPoint corners[4], int classId, quint8 flags = Edited);
+    void removeLast();
+    void rotateLast();
+    // Empties the model and forgets any modification.
+    void clear();
+
+    // Label files hold one "class x0 y0 x1 y1 x2 y2 x3 y3" line per box.
+    bool load(const QString &fileName, ClassTable *classes);
+    void loadData(const QByteArray &data, ClassTable *classes);
+    bool save(const QString &fileName, const ClassTable &classes) const;
+
+private:
+    QVector<QPoint> points;
+    QVector<int> classIds;
+    QVector<quint8> boxFlags;
+    bool removed;
+};
+
+#endif // ANNOTATIONMODEL_H
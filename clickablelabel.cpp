@@ -1,12 +1,80 @@
 #include "clickablelabel.h"
 
+#include <QPainter>
+
+static const int loupeSize = 160;
+static const int loupeMagnification = 8;
+static const int loupeOffset = 24;
+
+Loupe::Loupe(QWidget* parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    resize(loupeSize, loupeSize);
+}
+
+void Loupe::setSource(const QPixmap &pixmap)
+{
+    source = pixmap;
+    update();
+}
+
+void Loupe::setCenter(const QPointF &imagePos)
+{
+    center = imagePos;
+    update();
+}
+
+// The source rectangle is positioned with sub-pixel precision, so the pixel
+// grid slides smoothly under the crosshair instead of jumping.
+void Loupe::paintEvent(QPaintEvent * /* event */)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    const QSizeF span(double(width()) / loupeMagnification, double(height()) / loupeMagnification);
+    const QRectF sourceRect(center.x() - span.width() / 2, center.y() - span.height() / 2,
+                            span.width(), span.height());
+    painter.drawPixmap(QRectF(rect()), source, sourceRect);
+
+    const QPointF mid(width() / 2.0, height() / 2.0);
+    painter.setPen(QPen(QColor(255, 255, 255, 160), 1));
+    painter.drawLine(QPointF(mid.x(), 0), QPointF(mid.x(), height()));
+    painter.drawLine(QPointF(0, mid.y()), QPointF(width(), mid.y()));
+
+    const QString text = QString("%1, %2").arg(center.x(), 0, 'f', 1).arg(center.y(), 0, 'f', 1);
+    QRect textRect = fontMetrics().boundingRect(text).adjusted(-3, -1, 3, 1);
+    textRect.moveBottomLeft(rect().bottomLeft());
+    painter.fillRect(textRect, QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(textRect, Qt::AlignCenter, text);
+    painter.setPen(Qt::gray);
+    painter.drawRect(rect().adjusted(0, 0, -1, -1));
+}
+
 ClickableLabel::ClickableLabel(QWidget* parent)
-    : QLabel(parent)
+    : QLabel(parent), ev(0), rubberBand(0), loupeEnabled(false)
 {
 }
 
 ClickableLabel::~ClickableLabel()
 {
+    delete loupe;
+}
+
+void ClickableLabel::setSource(const QPixmap &pixmap)
+{
+    source = pixmap;
+    if (loupe)
+        loupe->setSource(pixmap);
+}
+
+void ClickableLabel::setLoupeEnabled(bool enabled)
+{
+    loupeEnabled = enabled;
+    setMouseTracking(enabled);
+    if (!enabled && loupe)
+        loupe->hide();
 }
 
 
@@ -24,10 +92,34 @@ void ClickableLabel::mousePressEvent(QMouseEvent *event)
 }
 
 
+// The loupe lives on the top-level window so it is not clipped by the
+// scroll area; it sits beside the cursor and flips at the window edges.
 void ClickableLabel::mouseMoveEvent(QMouseEvent *event)
 {
     //rubberBand->setGeometry(QRect(origin, event->pos()).normalized());
     //rubberBand->move(event->pos());
+    if (!loupeEnabled || source.isNull() || width() == 0 || height() == 0)
+        return;
+    if (!loupe) {
+        loupe = new Loupe(window());
+        loupe->setSource(source);
+    }
+    const QPointF imagePos(event->localPos().x() * source.width() / width(),
+                           event->localPos().y() * source.height() / height());
+    loupe->setCenter(imagePos);
+
+    QWidget *host = loupe->parentWidget();
+    const QPoint cursor = mapTo(host, event->pos());
+    QPoint topLeft = cursor + QPoint(loupeOffset, loupeOffset);
+    if (topLeft.x() + loupe->width() > host->width())
+        topLeft.setX(cursor.x() - loupeOffset - loupe->width());
+    if (topLeft.y() + loupe->height() > host->height())
+        topLeft.setY(cursor.y() - loupeOffset - loupe->height());
+    loupe->move(topLeft);
+    if (loupe->isHidden()) {
+        loupe->show();
+        loupe->raise();
+    }
 }
 
 void ClickableLabel::mouseReleaseEvent(QMouseEvent *event)
@@ -36,3 +128,9 @@ void ClickableLabel::mouseReleaseEvent(QMouseEvent *event)
     // determine selection, for example using QRect::intersects()
     // and QRect::contains().
 }
+
+void ClickableLabel::leaveEvent(QEvent * /* event */)
+{
+    if (loupe)
+        loupe->hide();
+}
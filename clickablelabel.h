@@ -5,6 +5,25 @@
 #include <QMouseEvent>
 #include <QDebug>
 #include <QRubberBand>
+#include <QPixmap>
+#include <QPointer>
+
+// Magnified view of a few pixels of the source image around the cursor.
+// Only the visible neighbourhood is drawn, so the cost does not depend on
+// the image size.
+class Loupe : public QWidget
+{
+Q_OBJECT
+public:
+    explicit Loupe(QWidget* parent=0);
+    void setSource(const QPixmap &pixmap);
+    void setCenter(const QPointF &imagePos);
+protected:
+    void paintEvent(QPaintEvent *event);
+private:
+    QPixmap source;
+    QPointF center;
+};
 
 class ClickableLabel : public QLabel
 {
@@ -12,18 +31,26 @@ Q_OBJECT
 public:
     explicit ClickableLabel(QWidget* parent=0);
     ~ClickableLabel();
+    // The unannotated image shown in the loupe.
+    void setSource(const QPixmap &pixmap);
+public slots:
+    void setLoupeEnabled(bool enabled);
 signals:
     void clicked();
 protected:
     void mousePressEvent(QMouseEvent* event);
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
+    void leaveEvent(QEvent *event);
 public:
     int x, y;
     QMouseEvent* ev;
     QPoint origin;
     QRubberBand* rubberBand;
+private:
+    QPixmap source;
+    QPointer<Loupe> loupe;
+    bool loupeEnabled;
 };
 
 #endif // CLICKABLELABEL
-
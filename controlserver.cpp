@@ -0,0 +1,156 @@
+#include "controlserver.h"
+#include "datasetpack.h"
+#include "imageviewer.h"
+
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+
+ControlServer::ControlServer(ImageViewer *viewer, QObject *parent)
+    : QObject(parent), viewer(viewer)
+{
+    connect(&server, &QLocalServer::newConnection, this, &ControlServer::newConnection);
+    connect(viewer, &ImageViewer::objectsSaved, this, &ControlServer::objectsSaved);
+}
+
+bool ControlServer::listen(const QString &name)
+{
+    // A crashed viewer can leave a stale socket file behind.
+    QLocalServer::removeServer(name);
+    return server.listen(name);
+}
+
+QString ControlServer::errorString() const
+{
+    return server.errorString();
+}
+
+void ControlServer::newConnection()
+{
+    while (QLocalSocket *client = server.nextPendingConnection()) {
+        connect(client, &QLocalSocket::readyRead, this, &ControlServer::readClient);
+        connect(client, &QLocalSocket::disconnected, this, &ControlServer::clientGone);
+    }
+}
+
+void ControlServer::readClient()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+    if (!client)
+        return;
+    // All complete lines are handled before the viewer gets to redraw once.
+    while (client->canReadLine()) {
+        const QByteArray line = client->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &error);
+        QJsonObject reply;
+        if (!document.isObject()) {
+            reply.insert("ok", false);
+            reply.insert("error", error.error != QJsonParseError::NoError ? error.errorString()
+                                                                          : QStringLiteral("expected an object"));
+        } else {
+            const QJsonObject request = document.object();
+            reply = handle(request, client);
+            if (request.contains("id"))
+                reply.insert("id", request.value("id"));
+        }
+        send(client, reply);
+    }
+}
+
+void ControlServer::clientGone()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+    if (!client)
+        return;
+    subscribers.remove(client);
+    client->deleteLater();
+}
+
+void ControlServer::objectsSaved(const QString &imageFile, const QString &labelFile)
+{
+    QJsonObject event;
+    event.insert("event", QStringLiteral("saved"));
+    event.insert("image", imageFile);
+    event.insert("labels", labelFile);
+    foreach (QLocalSocket *client, subscribers)
+        send(client, event);
+}
+
+QJsonObject ControlServer::handle(const QJsonObject &request, QLocalSocket *client)
+{
+    const QString cmd = request.value("cmd").toString();
+    QJsonObject reply;
+    reply.insert("ok", true);
+
+    if (cmd == "open") {
+        const QString fileName = request.value("file").toString();
+        // Pack entries are probed through the pack; QImageReader cannot open them.
+        const bool readable = DatasetPack::isPackPath(fileName) ? DatasetPack::fileSize(fileName) > 0
+                                                                : QImageReader(fileName).canRead();
+        if (!readable) {
+            reply.insert("ok", false);
+            reply.insert("error", QStringLiteral("cannot read %1").arg(fileName));
+        } else {
+            reply.insert("ok", viewer->openImage(fileName));
+        }
+    } else if (cmd == "boxes") {
+        const QJsonArray boxes = request.value("boxes").toArray();
+        QVector<QPoint> corners;
+        QStringList classNames;
+        corners.reserve(4 * boxes.size());
+        foreach (const QJsonValue &value, boxes) {
+            const QJsonObject box = value.toObject();
+            const QJsonArray points = box.value("points").toArray();
+            if (points.size() != 8)
+                continue;
+            for (int j = 0; j < 4; j++)
+                corners.append(QPoint(points[2 * j].toInt(), points[2 * j + 1].toInt()));
+            classNames.append(box.value("class").toString());
+        }
+        viewer->appendBoxes(corners, classNames);
+        reply.insert("added", classNames.size());
+    } else if (cmd == "clear") {
+        viewer->clearBoxes();
+    } else if (cmd == "save") {
+        if (!viewer->saveBoxes()) {
+            reply.insert("ok", false);
+            reply.insert("error", QStringLiteral("cannot save labels of %1").arg(viewer->currentImage()));
+        }
+    } else if (cmd == "query") {
+        const AnnotationModel &model = viewer->annotations();
+        const ClassTable &classes = viewer->classTable();
+        QJsonArray boxes;
+        for (int i = 0; i < model.size(); i++) {
+            const QPoint *c = model.corners(i);
+            QJsonArray points;
+            for (int j = 0; j < 4; j++) {
+                points.append(c[j].x());
+                points.append(c[j].y());
+            }
+            QJsonObject box;
+            box.insert("class", classes.name(model.classId(i)));
+            box.insert("points", points);
+            if (model.flags(i) & AnnotationModel::Predicted)
+                box.insert("predicted", true);
+            boxes.append(box);
+        }
+        reply.insert("file", viewer->currentImage());
+        reply.insert("boxes", boxes);
+    } else if (cmd == "subscribe") {
+        subscribers.insert(client);
+    } else {
+        reply.insert("ok", false);
+        reply.insert("error", QStringLiteral("unknown command %1").arg(cmd));
+    }
+    return reply;
+}
+
+void ControlServer::send(QLocalSocket *client, const QJsonObject &message)
+{
+    client->write(QJsonDocument(message).toJson(QJsonDocument::Compact));
+    client->write("\n");
+}
@@ -0,0 +1,44 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QJsonObject>
+#include <QSet>
+
+class QLocalSocket;
+class ImageViewer;
+
+// Local socket endpoint for scripting the viewer. Every request and reply is
+// one JSON object per line:
+//   {"cmd":"open","file":"/data/a.jpg"}
+//   {"cmd":"boxes","boxes":[{"class":"car","points":[x0,y0,x1,y1,x2,y2,x3,y3]}]}
+//   {"cmd":"clear"}  {"cmd":"save"}  {"cmd":"query"}  {"cmd":"subscribe"}
+// Replies carry "ok" and echo the request "id"; query marks boxes accepted
+// from predictions with "predicted":true. Subscribers also receive
+// {"event":"saved","image":...,"labels":...} whenever labels are written.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(ImageViewer *viewer, QObject *parent = 0);
+
+    bool listen(const QString &name);
+    QString errorString() const;
+
+private slots:
+    void newConnection();
+    void readClient();
+    void clientGone();
+    void objectsSaved(const QString &imageFile, const QString &labelFile);
+
+private:
+    QJsonObject handle(const QJsonObject &request, QLocalSocket *client);
+    static void send(QLocalSocket *client, const QJsonObject &message);
+
+    QLocalServer server;
+    ImageViewer *viewer;
+    QSet<QLocalSocket *> subscribers;
+};
+
+#endif // CONTROLSERVER_H
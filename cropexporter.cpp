@@ -0,0 +1,158 @@
+#include "cropexporter.h"
+#include "annotationmodel.h"
+#include "datasetpack.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QLineF>
+#include <QPointer>
+#include <QSemaphore>
+
+namespace {
+
+// Blends two ARGB32 pixels with weight t/256 for b. Red/blue and alpha/green
+// are interpolated as two 16-bit lanes per multiply.
+static inline uint interpolate(uint a, uint b, uint t)
+{
+    uint rb = ((a & 0x00ff00ff) * (256 - t) + (b & 0x00ff00ff) * t) >> 8;
+    uint ag = ((a >> 8) & 0x00ff00ff) * (256 - t) + ((b >> 8) & 0x00ff00ff) * t;
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+static QString classDirName(const QString &label)
+{
+    QString name = label;
+    name.replace(QLatin1Char('/'), QLatin1Char('_'));
+    name.replace(QLatin1Char('\\'), QLatin1Char('_'));
+    if (name.isEmpty() || name == "." || name == "..")
+        name = "_";
+    return name;
+}
+
+}
+
+CropExporter::CropExporter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CropExporter::~CropExporter()
+{
+    cancel();
+}
+
+void CropExporter::start(const QStringList &images, const QString &labelsDir, const QString &outputDir)
+{
+    cancel();
+    token = TaskScheduler::Token();
+
+    const TaskScheduler::Token token = this->token;
+    QSharedPointer<QAtomicInt> done(new QAtomicInt(0));
+    QSharedPointer<QAtomicInt> crops(new QAtomicInt(0));
+    const int total = images.size();
+    QPointer<CropExporter> self(this);
+    TaskScheduler::instance()->parallelFor(TaskScheduler::Background, total, [=](int i) {
+        crops->fetchAndAddRelaxed(exportImage(images.at(i), labelsDir, outputDir));
+        TaskScheduler::postProgress(self, token, done->fetchAndAddRelaxed(1) + 1, total, [self](int count, int total) {
+            emit self->progress(count, total);
+        });
+    }, token, [=]() {
+        TaskScheduler::runOnMain(self, [=]() {
+            if (token.isCancelled())
+                return;
+            emit self->finished(crops->load());
+        });
+    });
+}
+
+void CropExporter::cancel()
+{
+    token.cancel();
+}
+
+int CropExporter::exportAll(const QStringList &images, const QString &labelsDir, const QString &outputDir)
+{
+    QAtomicInt crops(0);
+    QSemaphore finished;
+    TaskScheduler::instance()->parallelFor(TaskScheduler::Background, images.size(), [&](int i) {
+        crops.fetchAndAddRelaxed(exportImage(images.at(i), labelsDir, outputDir));
+    }, TaskScheduler::Token(), [&]() {
+        finished.release();
+    });
+    finished.acquire();
+    return crops.load();
+}
+
+int CropExporter::exportImage(const QString &image, const QString &labelsDir, const QString &outputDir)
+{
+    const QFileInfo info(image);
+    QByteArray labels;
+    if (!DatasetPack::readLabels(image, labelsDir, &labels))
+        return 0;
+    ClassTable classes;
+    AnnotationModel boxes;
+    boxes.loadData(labels, &classes);
+    if (boxes.isEmpty())
+        return 0;
+
+    QImage source = DatasetPack::readImage(image);
+    if (source.isNull())
+        return 0;
+    source = source.convertToFormat(QImage::Format_ARGB32);
+
+    int crops = 0;
+    for (int i = 0; i < boxes.size(); i++) {
+        const QPoint *corners = boxes.corners(i);
+        const QPointF quad[4] = { corners[0], corners[1], corners[2], corners[3] };
+        QImage crop = warpQuad(source, quad);
+        if (crop.isNull())
+            continue;
+        const QString dir = outputDir + "/" + classDirName(classes.name(boxes.classId(i)));
+        QDir().mkpath(dir);
+        if (crop.save(dir + "/" + info.completeBaseName() + "_" + QString::number(i) + ".png"))
+            crops++;
+    }
+    return crops;
+}
+
+// quad[0]->quad[1] becomes the top edge and quad[0]->quad[3] the left edge of
+// the crop, matching the corner order written by ImageViewer::writeObjects().
+QImage CropExporter::warpQuad(const QImage &source, const QPointF quad[4])
+{
+    const int width = qRound(QLineF(quad[0], quad[1]).length());
+    const int height = qRound(QLineF(quad[0], quad[3]).length());
+    if (width < 1 || height < 1 || source.format() != QImage::Format_ARGB32)
+        return QImage();
+
+    QImage crop(width, height, QImage::Format_ARGB32);
+    const QPointF du = (quad[1] - quad[0]) / width;
+    const QPointF dv = (quad[3] - quad[0]) / height;
+    // Sample at pixel centres, stepping in 16.16 fixed point along each row.
+    const QPointF origin = quad[0] + (du + dv) / 2 - QPointF(0.5, 0.5);
+    const int stepX = qRound(du.x() * 65536);
+    const int stepY = qRound(du.y() * 65536);
+    const int maxX = source.width() - 1;
+    const int maxY = source.height() - 1;
+    const uint *bits = reinterpret_cast<const uint *>(source.constBits());
+    const int stride = source.bytesPerLine() / 4;
+
+    for (int v = 0; v < height; v++) {
+        const QPointF start = origin + dv * v;
+        int fx = qRound(start.x() * 65536);
+        int fy = qRound(start.y() * 65536);
+        uint *out = reinterpret_cast<uint *>(crop.scanLine(v));
+        for (int u = 0; u < width; u++, fx += stepX, fy += stepY) {
+            const int x0 = qBound(0, fx >> 16, maxX);
+            const int y0 = qBound(0, fy >> 16, maxY);
+            const int x1 = qMin(x0 + 1, maxX);
+            const int y1 = qMin(y0 + 1, maxY);
+            const uint tx = (fx >> 8) & 0xff;
+            const uint ty = (fy >> 8) & 0xff;
+            const uint *r0 = bits + y0 * stride;
+            const uint *r1 = bits + y1 * stride;
+            out[u] = interpolate(interpolate(r0[x0], r0[x1], tx),
+                                 interpolate(r1[x0], r1[x1], tx), ty);
+        }
+    }
+    return crop;
+}
@@ -0,0 +1,36 @@
+#ifndef CROPEXPORTER_H
+#define CROPEXPORTER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QImage>
+#include <QPointF>
+
+#include "taskscheduler.h"
+
+// Cuts every labelled quad out of its image as an upright crop and writes it
+// to outputDir/<class>/. Each image is decoded once; images are processed in
+// parallel, so at most one decoded image per worker thread is alive at a time.
+class CropExporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CropExporter(QObject *parent = 0);
+    ~CropExporter();
+
+    void start(const QStringList &images, const QString &labelsDir, const QString &outputDir);
+    void cancel();
+
+    static int exportAll(const QStringList &images, const QString &labelsDir, const QString &outputDir);
+    static int exportImage(const QString &image, const QString &labelsDir, const QString &outputDir);
+    static QImage warpQuad(const QImage &source, const QPointF quad[4]);
+
+signals:
+    void progress(int done, int total);
+    void finished(int crops);
+
+private:
+    TaskScheduler::Token token;
+};
+
+#endif // CROPEXPORTER_H
@@ -0,0 +1,277 @@
+#include "datasetpack.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+
+static const quint32 packMagic = 0x4b505649;   // "IVPK" in little endian
+static const quint32 packVersion = 1;
+static const int headerSize = 16;
+static const char packSuffix[] = ".ivpk";
+
+DatasetPack::DatasetPack()
+    : data(0), length(0)
+{
+}
+
+DatasetPack::~DatasetPack()
+{
+    if (data)
+        file.unmap(const_cast<uchar *>(data));
+}
+
+bool DatasetPack::open(const QString &fileName)
+{
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    length = file.size();
+    if (length < headerSize)
+        return false;
+    data = file.map(0, length);
+    if (!data)
+        return false;
+
+    QByteArray header = QByteArray::fromRawData(reinterpret_cast<const char *>(data), headerSize);
+    QDataStream in(header);
+    in.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic;
+    quint32 version;
+    quint64 indexOffset;
+    in >> magic >> version >> indexOffset;
+    if (magic != packMagic || version != packVersion || indexOffset < quint64(headerSize)
+            || indexOffset > quint64(length))
+        return false;
+
+    QByteArray index = QByteArray::fromRawData(reinterpret_cast<const char *>(data) + indexOffset,
+                                               int(length - qint64(indexOffset)));
+    QDataStream stream(index);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 count;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        Entry entry;
+        quint64 offset, size, labelOffset, labelSize;
+        stream >> entry.name >> offset >> size >> entry.width >> entry.height >> labelOffset >> labelSize;
+        if (offset + size > indexOffset || labelOffset + labelSize > indexOffset)
+            return false;
+        entry.offset = qint64(offset);
+        entry.size = qint64(size);
+        entry.labelOffset = qint64(labelOffset);
+        entry.labelSize = qint64(labelSize);
+        byName.insert(entry.name, entries.size());
+        entries.append(entry);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+QString DatasetPack::fileName() const
+{
+    return file.fileName();
+}
+
+int DatasetPack::count() const
+{
+    return entries.size();
+}
+
+const DatasetPack::Entry &DatasetPack::entry(int i) const
+{
+    return entries[i];
+}
+
+int DatasetPack::indexOf(const QString &name) const
+{
+    return byName.value(name, -1);
+}
+
+QString DatasetPack::pathOf(int i) const
+{
+    return file.fileName() + QLatin1Char('#') + entries[i].name;
+}
+
+QByteArray DatasetPack::imageData(int i) const
+{
+    const Entry &e = entries[i];
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data) + e.offset, int(e.size));
+}
+
+QByteArray DatasetPack::labelData(int i) const
+{
+    const Entry &e = entries[i];
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data) + e.labelOffset, int(e.labelSize));
+}
+
+bool DatasetPack::build(const QString &directory, const QString &packFile, QString *error)
+{
+    const QString root = QDir::cleanPath(directory);
+    const QString labelsDir = root + "/labels";
+    const QString packPath = QFileInfo(packFile).absoluteFilePath();
+    QStringList files;
+    QDirIterator it(root, QDir::Files | QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString fileName = it.next();
+        if (it.fileInfo().path() != labelsDir && it.fileInfo().absoluteFilePath() != packPath)
+            files.append(fileName);
+    }
+    files.sort();
+
+    QFile out(packFile);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = out.errorString();
+        return false;
+    }
+    QDataStream stream(&out);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << packMagic << packVersion << quint64(0);
+
+    QVector<Entry> entries;
+    const QDir rootDir(root);
+    foreach (const QString &fileName, files) {
+        QImageReader reader(fileName);
+        if (!reader.canRead())
+            continue;
+        const QSize size = reader.size();
+        QFile image(fileName);
+        if (!image.open(QIODevice::ReadOnly))
+            continue;
+        Entry entry;
+        entry.name = rootDir.relativeFilePath(fileName);
+        entry.width = size.width();
+        entry.height = size.height();
+        entry.offset = out.pos();
+        const QByteArray bytes = image.readAll();
+        entry.size = bytes.size();
+        entry.labelOffset = entry.offset + entry.size;
+        entry.labelSize = 0;
+        if (out.write(bytes) != bytes.size()) {
+            *error = out.errorString();
+            return false;
+        }
+        QFile labels(labelsDir + "/" + QFileInfo(fileName).completeBaseName() + ".txt");
+        if (labels.open(QIODevice::ReadOnly)) {
+            const QByteArray text = labels.readAll();
+            entry.labelSize = text.size();
+            out.write(text);
+        }
+        entries.append(entry);
+    }
+
+    const quint64 indexOffset = quint64(out.pos());
+    stream << quint32(entries.size());
+    foreach (const Entry &entry, entries) {
+        stream << entry.name << quint64(entry.offset) << quint64(entry.size) << entry.width << entry.height
+               << quint64(entry.labelOffset) << quint64(entry.labelSize);
+    }
+    out.seek(8);
+    stream << indexOffset;
+    if (stream.status() != QDataStream::Ok || out.error() != QFile::NoError) {
+        *error = out.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool DatasetPack::isPackFile(const QString &fileName)
+{
+    return fileName.endsWith(QLatin1String(packSuffix), Qt::CaseInsensitive) && QFileInfo(fileName).isFile();
+}
+
+bool DatasetPack::isPackPath(const QString &path)
+{
+    return path.indexOf(QLatin1String(packSuffix) + QLatin1Char('#'), 0, Qt::CaseInsensitive) >= 0;
+}
+
+bool DatasetPack::splitPath(const QString &path, QString *packFile, QString *name)
+{
+    int at = path.indexOf(QLatin1String(packSuffix) + QLatin1Char('#'), 0, Qt::CaseInsensitive);
+    if (at < 0)
+        return false;
+    at += int(sizeof(packSuffix)) - 1;
+    *packFile = path.left(at);
+    *name = path.mid(at + 1);
+    return true;
+}
+
+QSharedPointer<DatasetPack> DatasetPack::shared(const QString &packFile)
+{
+    static QMutex mutex;
+    static QHash<QString, QSharedPointer<DatasetPack> > packs;
+    QMutexLocker locker(&mutex);
+    QHash<QString, QSharedPointer<DatasetPack> >::const_iterator it = packs.constFind(packFile);
+    if (it != packs.constEnd())
+        return it.value();
+    QSharedPointer<DatasetPack> pack(new DatasetPack);
+    if (!pack->open(packFile))
+        return QSharedPointer<DatasetPack>();
+    packs.insert(packFile, pack);
+    return pack;
+}
+
+QImage DatasetPack::readImage(const QString &path, const QSize &scaledSize)
+{
+    QString packFile, name;
+    if (!splitPath(path, &packFile, &name)) {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+        if (scaledSize.isValid())
+            reader.setScaledSize(scaledSize);
+        return reader.read();
+    }
+    QSharedPointer<DatasetPack> pack = shared(packFile);
+    int i = pack ? pack->indexOf(name) : -1;
+    if (i < 0)
+        return QImage();
+    QByteArray bytes = pack->imageData(i);
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    if (scaledSize.isValid())
+        reader.setScaledSize(scaledSize);
+    return reader.read();
+}
+
+qint64 DatasetPack::fileSize(const QString &path)
+{
+    QString packFile, name;
+    if (!splitPath(path, &packFile, &name))
+        return QFileInfo(path).size();
+    QSharedPointer<DatasetPack> pack = shared(packFile);
+    int i = pack ? pack->indexOf(name) : -1;
+    return i < 0 ? 0 : pack->entry(i).size;
+}
+
+QString DatasetPack::labelFileName(const QString &path, const QString &labelsDir)
+{
+    QString packFile, name = path;
+    splitPath(path, &packFile, &name);
+    return labelsDir + "/" + QFileInfo(name).completeBaseName() + ".txt";
+}
+
+// Edited labels are written beside the pack, so they win over the packed ones.
+bool DatasetPack::readLabels(const QString &path, const QString &labelsDir, QByteArray *labels)
+{
+    QFile file(labelFileName(path, labelsDir));
+    if (file.open(QIODevice::ReadOnly)) {
+        *labels = file.readAll();
+        return true;
+    }
+    QString packFile, name;
+    if (!splitPath(path, &packFile, &name))
+        return false;
+    QSharedPointer<DatasetPack> pack = shared(packFile);
+    int i = pack ? pack->indexOf(name) : -1;
+    if (i < 0 || pack->entry(i).labelSize == 0)
+        return false;
+    const QByteArray data = pack->labelData(i);
+    *labels = QByteArray(data.constData(), data.size());
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef DATASETPACK_H
+#define DATASETPACK_H
+
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+// A whole dataset in one memory-mapped file, so browsing over network storage
+// costs one open instead of a stat and an open per image. Layout:
+//   "IVPK" magic, quint32 version, quint64 index offset
+//   image and label blobs, back to back
+//   index: quint32 count, then per entry name, offset, size, width, height,
+//          label offset, label size (QDataStream encoding)
+// Files inside a pack are addressed as "<pack>.ivpk#<relative name>".
+class DatasetPack
+{
+public:
+    struct Entry {
+        QString name;
+        qint64 offset;
+        qint64 size;
+        qint32 width;
+        qint32 height;
+        qint64 labelOffset;
+        qint64 labelSize;
+    };
+
+    DatasetPack();
+    ~DatasetPack();
+
+    bool open(const QString &fileName);
+    QString fileName() const;
+    int count() const;
+    const Entry &entry(int i) const;
+    int indexOf(const QString &name) const;
+    QString pathOf(int i) const;
+
+    // The returned arrays point straight into the mapping; nothing is copied.
+    QByteArray imageData(int i) const;
+    QByteArray labelData(int i) const;
+
+    static bool build(const QString &directory, const QString &packFile, QString *error);
+
+    static bool isPackFile(const QString &fileName);
+    static bool isPackPath(const QString &path);
+    static bool splitPath(const QString &path, QString *packFile, QString *name);
+    // Opens each pack once per process; safe to call from any thread.
+    static QSharedPointer<DatasetPack> shared(const QString &packFile);
+
+    // Decode and size helpers that accept both plain files and pack paths.
+    static QImage readImage(const QString &path, const QSize &scaledSize = QSize());
+    static qint64 fileSize(const QString &path);
+    // "<labelsDir>/<stem>.txt" for a plain file or a pack entry.
+    static QString labelFileName(const QString &path, const QString &labelsDir);
+    // Reads that file, falling back to the labels stored in the pack. Returns
+    // false if the image has neither.
+    static bool readLabels(const QString &path, const QString &labelsDir, QByteArray *labels);
+
+private:
+    QFile file;
+    const uchar *data;
+    qint64 length;
+    QVector<Entry> entries;
+    QHash<QString, int> byName;
+};
+
+#endif // DATASETPACK_H
@@ -0,0 +1,197 @@
+#include "duplicatefinder.h"
+#include "datasetpack.h"
+
+#include <QImage>
+#include <QPointer>
+
+namespace {
+
+// BK-tree over Hamming distance; identical hashes share a node.
+class BkTree
+{
+public:
+    void insert(quint64 hash, int item)
+    {
+        if (nodes.isEmpty()) {
+            nodes.append(Node(hash, item));
+            return;
+        }
+        int current = 0;
+        for (;;) {
+            int d = DuplicateFinder::hammingDistance(hash, nodes[current].hash);
+            if (d == 0) {
+                nodes[current].items.append(item);
+                return;
+            }
+            int next = -1;
+            foreach (const Edge &edge, nodes[current].children) {
+                if (edge.distance == d) {
+                    next = edge.node;
+                    break;
+                }
+            }
+            if (next < 0) {
+                nodes.append(Node(hash, item));
+                nodes[current].children.append(Edge(d, nodes.size() - 1));
+                return;
+            }
+            current = next;
+        }
+    }
+
+    void query(quint64 hash, int maxDistance, QVector<int> *result) const
+    {
+        if (nodes.isEmpty())
+            return;
+        QVector<int> stack;
+        stack.append(0);
+        while (!stack.isEmpty()) {
+            const Node &node = nodes[stack.takeLast()];
+            int d = DuplicateFinder::hammingDistance(hash, node.hash);
+            if (d <= maxDistance)
+                *result += node.items;
+            foreach (const Edge &edge, node.children) {
+                if (edge.distance >= d - maxDistance && edge.distance <= d + maxDistance)
+                    stack.append(edge.node);
+            }
+        }
+    }
+
+private:
+    struct Edge {
+        Edge(int d = 0, int n = 0) : distance(d), node(n) {}
+        int distance;
+        int node;
+    };
+    struct Node {
+        Node(quint64 h = 0, int item = 0) : hash(h) { items.append(item); }
+        quint64 hash;
+        QVector<int> items;
+        QVector<Edge> children;
+    };
+    QVector<Node> nodes;
+};
+
+static int findRoot(QVector<int> &parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+}
+
+DuplicateFinder::DuplicateFinder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DuplicateFinder::~DuplicateFinder()
+{
+    cancel();
+}
+
+void DuplicateFinder::start(const QStringList &files, int maxDistance)
+{
+    cancel();
+    token = TaskScheduler::Token();
+
+    const TaskScheduler::Token token = this->token;
+    QSharedPointer<QVector<Hash> > hashes(new QVector<Hash>(files.size()));
+    QSharedPointer<QAtomicInt> done(new QAtomicInt(0));
+    const int total = files.size();
+    QPointer<DuplicateFinder> self(this);
+    TaskScheduler::instance()->parallelFor(TaskScheduler::Background, total, [=](int i) {
+        (*hashes)[i] = dHash(files.at(i));
+        TaskScheduler::postProgress(self, token, done->fetchAndAddRelaxed(1) + 1, total, [self](int count, int total) {
+            emit self->progress(count, total);
+        });
+    }, token, [=]() {
+        if (token.isCancelled())
+            return;
+        QList<QStringList> groups = group(files, *hashes, maxDistance);
+        TaskScheduler::runOnMain(self, [=]() {
+            if (token.isCancelled())
+                return;
+            emit self->finished(groups);
+        });
+    });
+}
+
+void DuplicateFinder::cancel()
+{
+    token.cancel();
+}
+
+DuplicateFinder::Hash DuplicateFinder::dHash(const QString &fileName)
+{
+    Hash hash = { 0, false };
+    // Formats like JPEG decode straight to a reduced size here.
+    QImage image = DatasetPack::readImage(fileName, QSize(9, 8));
+    if (image.isNull())
+        return hash;
+    if (image.size() != QSize(9, 8))
+        image = image.scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    image = image.convertToFormat(QImage::Format_Grayscale8);
+    for (int y = 0; y < 8; y++) {
+        const uchar *row = image.constScanLine(y);
+        for (int x = 0; x < 8; x++) {
+            hash.value <<= 1;
+            if (row[x] < row[x + 1])
+                hash.value |= 1;
+        }
+    }
+    hash.valid = true;
+    return hash;
+}
+
+int DuplicateFinder::hammingDistance(quint64 a, quint64 b)
+{
+    return qPopulationCount(a ^ b);
+}
+
+QList<QStringList> DuplicateFinder::group(const QStringList &files, const QVector<Hash> &hashes, int maxDistance)
+{
+    BkTree tree;
+    for (int i = 0; i < hashes.size(); i++) {
+        if (hashes[i].valid)
+            tree.insert(hashes[i].value, i);
+    }
+
+    QVector<int> parent(hashes.size());
+    for (int i = 0; i < parent.size(); i++)
+        parent[i] = i;
+    QVector<int> neighbours;
+    for (int i = 0; i < hashes.size(); i++) {
+        if (!hashes[i].valid)
+            continue;
+        neighbours.clear();
+        tree.query(hashes[i].value, maxDistance, &neighbours);
+        foreach (int j, neighbours) {
+            int a = findRoot(parent, i);
+            int b = findRoot(parent, j);
+            if (a != b)
+                parent[qMax(a, b)] = qMin(a, b);
+        }
+    }
+
+    // Groups are ordered by their first file so the result follows the file list.
+    QList<QStringList> groups;
+    QVector<int> groupOfRoot(hashes.size(), -1);
+    QVector<int> count(hashes.size(), 0);
+    for (int i = 0; i < hashes.size(); i++)
+        count[findRoot(parent, i)]++;
+    for (int i = 0; i < hashes.size(); i++) {
+        int root = findRoot(parent, i);
+        if (count[root] < 2)
+            continue;
+        if (groupOfRoot[root] < 0) {
+            groupOfRoot[root] = groups.size();
+            groups.append(QStringList());
+        }
+        groups[groupOfRoot[root]].append(files.at(i));
+    }
+    return groups;
+}
@@ -0,0 +1,41 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+
+#include "taskscheduler.h"
+
+// Finds near-duplicate images by comparing 64-bit difference hashes (dHash)
+// computed on reduced-size decodes. Hashing runs on all cores, grouping uses
+// a BK-tree so only hashes within maxDistance bits are ever compared.
+class DuplicateFinder : public QObject
+{
+    Q_OBJECT
+public:
+    struct Hash {
+        quint64 value;
+        bool valid;
+    };
+
+    explicit DuplicateFinder(QObject *parent = 0);
+    ~DuplicateFinder();
+
+    void start(const QStringList &files, int maxDistance = 6);
+    void cancel();
+
+    static Hash dHash(const QString &fileName);
+    static int hammingDistance(quint64 a, quint64 b);
+    static QList<QStringList> group(const QStringList &files, const QVector<Hash> &hashes, int maxDistance);
+
+signals:
+    void progress(int done, int total);
+    void finished(const QList<QStringList> &groups);
+
+private:
+    TaskScheduler::Token token;
+};
+
+#endif // DUPLICATEFINDER_H
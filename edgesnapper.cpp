@@ -0,0 +1,159 @@
+#include "edgesnapper.h"
+
+#include <QRect>
+
+static const int tileSize = 32;
+static const int margin = 2;                  // one pixel for Sobel, one for the 3x3 tensor window
+static const int span = tileSize + 2 * margin;
+static const int maxCachedTiles = 256;        // 8 KB each
+static const float harrisK = 0.04f;
+static const float cornerThreshold = 1e-4f;
+static const float edgeThreshold = 0.0025f;   // a step of about 25 grey levels
+
+EdgeSnapper::EdgeSnapper()
+    : tiles(maxCachedTiles)
+{
+}
+
+void EdgeSnapper::setImage(const QPixmap &image)
+{
+    source = image;
+    tiles.clear();
+}
+
+void EdgeSnapper::clear()
+{
+    setImage(QPixmap());
+}
+
+// Candidates are weighted by distance so a slightly weaker response right
+// under the cursor wins over a strong one at the edge of the window.
+QPoint EdgeSnapper::snap(const QPoint &pos, int radius)
+{
+    if (source.isNull() || !source.rect().contains(pos) || radius <= 0)
+        return pos;
+    const QRect window = QRect(pos - QPoint(radius, radius), pos + QPoint(radius, radius)) & source.rect();
+    const float falloff = 1.0f / (radius * radius);
+    QPoint bestCorner;
+    QPoint bestEdge;
+    float cornerScore = cornerThreshold;
+    float edgeScore = edgeThreshold;
+    bool foundCorner = false;
+    bool foundEdge = false;
+
+    for (int ty = window.top() / tileSize; ty <= window.bottom() / tileSize; ty++) {
+        for (int tx = window.left() / tileSize; tx <= window.right() / tileSize; tx++) {
+            const Tile *t = tile(tx, ty);
+            const QPoint origin(tx * tileSize, ty * tileSize);
+            const QRect area = window & QRect(origin, QSize(tileSize, tileSize));
+            for (int y = area.top(); y <= area.bottom(); y++) {
+                const int dy = y - pos.y();
+                const float *corner = t->corner.constData() + (y - origin.y()) * tileSize;
+                const float *edge = t->edge.constData() + (y - origin.y()) * tileSize;
+                for (int x = area.left(); x <= area.right(); x++) {
+                    const int dx = x - pos.x();
+                    const int i = x - origin.x();
+                    const float weight = 1.0f / (1.0f + (dx * dx + dy * dy) * falloff);
+                    if (corner[i] * weight > cornerScore) {
+                        cornerScore = corner[i] * weight;
+                        bestCorner = QPoint(x, y);
+                        foundCorner = true;
+                    }
+                    if (edge[i] * weight > edgeScore) {
+                        edgeScore = edge[i] * weight;
+                        bestEdge = QPoint(x, y);
+                        foundEdge = true;
+                    }
+                }
+            }
+        }
+    }
+    if (foundCorner)
+        return bestCorner;
+    return foundEdge ? bestEdge : pos;
+}
+
+const EdgeSnapper::Tile *EdgeSnapper::tile(int tx, int ty)
+{
+    const quint64 key = (quint64(quint32(ty)) << 32) | quint32(tx);
+    Tile *t = tiles.object(key);
+    if (!t) {
+        t = computeTile(tx, ty);
+        tiles.insert(key, t);
+    }
+    return t;
+}
+
+// Only the tile plus its margin is converted to grey, never the whole image.
+// The kernels run over flat float rows without branches so the compiler can
+// vectorize them.
+EdgeSnapper::Tile *EdgeSnapper::computeTile(int tx, int ty) const
+{
+    const int x0 = tx * tileSize - margin;
+    const int y0 = ty * tileSize - margin;
+    const QRect area = QRect(x0, y0, span, span) & source.rect();
+    const QImage patch = source.copy(area).toImage().convertToFormat(QImage::Format_Grayscale8);
+
+    // Pixels outside the image repeat the border.
+    QVector<float> grey(span * span);
+    QVector<int> columns(span);
+    for (int x = 0; x < span; x++)
+        columns[x] = qBound(area.left(), x0 + x, area.right()) - area.left();
+    for (int y = 0; y < span; y++) {
+        const uchar *line = patch.constScanLine(qBound(area.top(), y0 + y, area.bottom()) - area.top());
+        float *row = grey.data() + y * span;
+        for (int x = 0; x < span; x++)
+            row[x] = line[columns[x]] * (1.0f / 255);
+    }
+
+    QVector<float> gradients(2 * span * span);
+    float *gx = gradients.data();
+    float *gy = gx + span * span;
+    for (int y = 1; y < span - 1; y++) {
+        const float *up = grey.constData() + (y - 1) * span;
+        const float *mid = up + span;
+        const float *down = mid + span;
+        float *outX = gx + y * span;
+        float *outY = gy + y * span;
+        for (int x = 1; x < span - 1; x++) {
+            outX[x] = ((up[x + 1] + 2 * mid[x + 1] + down[x + 1]) - (up[x - 1] + 2 * mid[x - 1] + down[x - 1]))
+                    * 0.125f;
+            outY[x] = ((down[x - 1] + 2 * down[x] + down[x + 1]) - (up[x - 1] + 2 * up[x] + up[x + 1])) * 0.125f;
+        }
+    }
+
+    // Structure tensor: products of gradients summed horizontally, then
+    // vertically below, over a 3x3 window.
+    QVector<float> sums(3 * span * span);
+    float *hxx = sums.data();
+    float *hyy = hxx + span * span;
+    float *hxy = hyy + span * span;
+    for (int y = 1; y < span - 1; y++) {
+        const float *rx = gx + y * span;
+        const float *ry = gy + y * span;
+        for (int x = margin; x < margin + tileSize; x++) {
+            const int i = y * span + x;
+            hxx[i] = rx[x - 1] * rx[x - 1] + rx[x] * rx[x] + rx[x + 1] * rx[x + 1];
+            hyy[i] = ry[x - 1] * ry[x - 1] + ry[x] * ry[x] + ry[x + 1] * ry[x + 1];
+            hxy[i] = rx[x - 1] * ry[x - 1] + rx[x] * ry[x] + rx[x + 1] * ry[x + 1];
+        }
+    }
+
+    Tile *t = new Tile;
+    t->corner.resize(tileSize * tileSize);
+    t->edge.resize(tileSize * tileSize);
+    for (int y = 0; y < tileSize; y++) {
+        const int row = (y + margin) * span;
+        float *corner = t->corner.data() + y * tileSize;
+        float *edge = t->edge.data() + y * tileSize;
+        for (int x = margin; x < margin + tileSize; x++) {
+            const float sxx = hxx[row - span + x] + hxx[row + x] + hxx[row + span + x];
+            const float syy = hyy[row - span + x] + hyy[row + x] + hyy[row + span + x];
+            const float sxy = hxy[row - span + x] + hxy[row + x] + hxy[row + span + x];
+            const float trace = sxx + syy;
+            corner[x - margin] = sxx * syy - sxy * sxy - harrisK * trace * trace;
+            edge[x - margin] = gx[row + x] * gx[row + x] + gy[row + x] * gy[row + x];
+        }
+    }
+    return t;
+}
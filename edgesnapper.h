@@ -0,0 +1,38 @@
+#ifndef EDGESNAPPER_H
+#define EDGESNAPPER_H
+
+#include <QCache>
+#include <QPixmap>
+#include <QPoint>
+#include <QVector>
+
+// Moves a clicked point onto the strongest nearby corner (Harris response)
+// or, failing that, the strongest edge (Sobel gradient magnitude). Responses
+// are computed lazily per 32x32 tile the first time a click lands near it and
+// cached, so a click costs at most a handful of small tiles. The snapper
+// shares the viewer's pixmap and converts one tile patch at a time, so it
+// never holds a second full-resolution copy.
+class EdgeSnapper
+{
+public:
+    EdgeSnapper();
+
+    void setImage(const QPixmap &image);
+    void clear();
+    // Returns pos unchanged when nothing within radius stands out.
+    QPoint snap(const QPoint &pos, int radius);
+
+private:
+    struct Tile {
+        QVector<float> corner;
+        QVector<float> edge;
+    };
+
+    const Tile *tile(int tx, int ty);
+    Tile *computeTile(int tx, int ty) const;
+
+    QPixmap source;
+    QCache<quint64, Tile> tiles;
+};
+
+#endif // EDGESNAPPER_H
@@ -0,0 +1,348 @@
+#include "fileindex.h"
+#include "datasetpack.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QRegularExpression>
+
+namespace {
+
+// Cancellation is polled once per block so the check stays off the hot path.
+static const int cancelCheckInterval = 4096;
+
+template <typename Predicate>
+static void matchRange(int begin, int end, QVector<int> *result, const TaskScheduler::Token &token,
+                       Predicate matches)
+{
+    for (int i = begin; i < end; i++) {
+        if ((i - begin) % cancelCheckInterval == 0 && token.isCancelled())
+            return;
+        if (matches(i))
+            result->append(i);
+    }
+}
+
+static void scanRecursion(const QString &path, const QString &relative, FileIndex *index,
+                          const TaskScheduler::Token &token)
+{
+    if (token.isCancelled())
+        return;
+    QDir currentDir(path);
+    foreach (const QFileInfo &info, currentDir.entryInfoList(QDir::Files | QDir::NoSymLinks, QDir::Name))
+        index->append(relative + info.fileName(), info.size());
+    foreach (const QString &dir, currentDir.entryList(QDir::Dirs | QDir::NoSymLinks | QDir::NoDotAndDotDot))
+        scanRecursion(path + QLatin1Char('/') + dir, relative + dir + QLatin1Char('/'), index, token);
+}
+
+}
+
+FileIndex::FileIndex(const QString &root, const QString &prefix)
+    : rootPath(root), prefix(prefix)
+{
+    starts.append(0);
+}
+
+QString FileIndex::root() const
+{
+    return rootPath;
+}
+
+int FileIndex::count() const
+{
+    return sizes.size();
+}
+
+void FileIndex::reserve(int entries, int characters)
+{
+    chars.reserve(characters);
+    starts.reserve(entries + 1);
+    nameStarts.reserve(entries);
+    sizes.reserve(entries);
+}
+
+void FileIndex::append(const QString &relativePath, qint64 size)
+{
+    nameStarts.append(chars.size() + relativePath.lastIndexOf(QLatin1Char('/')) + 1);
+    chars += relativePath;
+    starts.append(chars.size());
+    sizes.append(size);
+}
+
+void FileIndex::squeeze()
+{
+    chars.squeeze();
+    starts.squeeze();
+    nameStarts.squeeze();
+    sizes.squeeze();
+}
+
+QString FileIndex::relativePath(int i) const
+{
+    return chars.mid(starts[i], starts[i + 1] - starts[i]);
+}
+
+QString FileIndex::absolutePath(int i) const
+{
+    return prefix + relativePath(i);
+}
+
+qint64 FileIndex::size(int i) const
+{
+    return sizes[i];
+}
+
+int FileIndex::indexOf(const QString &relativePath) const
+{
+    for (int i = 0; i < count(); i++) {
+        if (QStringRef(&chars, starts[i], starts[i + 1] - starts[i]) == relativePath)
+            return i;
+    }
+    return -1;
+}
+
+bool FileIndex::sameEntries(const FileIndex &other) const
+{
+    return rootPath == other.rootPath && starts == other.starts && sizes == other.sizes && chars == other.chars;
+}
+
+void FileIndex::save(QDataStream &out) const
+{
+    out << rootPath << prefix << chars << starts << nameStarts << sizes;
+}
+
+QSharedPointer<FileIndex> FileIndex::load(QDataStream &in)
+{
+    QSharedPointer<FileIndex> index(new FileIndex);
+    in >> index->rootPath >> index->prefix >> index->chars >> index->starts >> index->nameStarts >> index->sizes;
+    const int count = index->sizes.size();
+    if (in.status() != QDataStream::Ok || index->starts.size() != count + 1
+            || index->nameStarts.size() != count || index->starts.last() != index->chars.size())
+        return QSharedPointer<FileIndex>();
+    return index;
+}
+
+FileIndex::MatchMode FileIndex::modeOf(const QString &pattern, QString *expression)
+{
+    if (pattern.startsWith(QLatin1String("re:"))) {
+        *expression = pattern.mid(3);
+        return RegularExpression;
+    }
+    *expression = pattern;
+    if (pattern.isEmpty() || pattern == QLatin1String("*"))
+        return MatchAll;
+    if (pattern.contains(QRegExp(QStringLiteral("[*?\\[]"))))
+        return Wildcard;
+    return Substring;
+}
+
+// Names are matched in place: a QStringRef or a raw-data QString over the
+// shared buffer, so no path is copied while filtering.
+void FileIndex::match(const QString &pattern, int begin, int end, QVector<int> *result,
+                      const TaskScheduler::Token &token) const
+{
+    QString expression;
+    const MatchMode mode = modeOf(pattern, &expression);
+    const QChar *data = chars.constData();
+    const int *start = starts.constData();
+    const int *nameStart = nameStarts.constData();
+
+    switch (mode) {
+    case MatchAll:
+        matchRange(begin, end, result, token, [](int) { return true; });
+        break;
+    case Substring:
+        matchRange(begin, end, result, token, [&](int i) {
+            return QStringRef(&chars, nameStart[i], start[i + 1] - nameStart[i])
+                    .contains(expression, Qt::CaseInsensitive);
+        });
+        break;
+    case Wildcard: {
+        QRegExp matcher(expression, Qt::CaseInsensitive, QRegExp::Wildcard);
+        matchRange(begin, end, result, token, [&](int i) {
+            return matcher.exactMatch(QString::fromRawData(data + nameStart[i], start[i + 1] - nameStart[i]));
+        });
+        break;
+    }
+    case RegularExpression: {
+        QRegularExpression matcher(expression);
+        if (!matcher.isValid())
+            return;
+        matcher.optimize();
+        matchRange(begin, end, result, token, [&](int i) {
+            return matcher.match(QString::fromRawData(data + nameStart[i], start[i + 1] - nameStart[i]))
+                    .hasMatch();
+        });
+        break;
+    }
+    }
+}
+
+QSharedPointer<FileIndex> FileIndex::scanDirectory(const QString &root, const TaskScheduler::Token &token)
+{
+    QSharedPointer<FileIndex> index(new FileIndex(root, root + QLatin1Char('/')));
+    scanRecursion(root, QString(), index.data(), token);
+    index->squeeze();
+    return index;
+}
+
+QSharedPointer<FileIndex> FileIndex::scanPack(const QSharedPointer<DatasetPack> &pack)
+{
+    QSharedPointer<FileIndex> index(new FileIndex(pack->fileName(), pack->fileName() + QLatin1Char('#')));
+    index->reserve(pack->count(), 0);
+    for (int i = 0; i < pack->count(); i++)
+        index->append(pack->entry(i).name, pack->entry(i).size);
+    index->squeeze();
+    return index;
+}
+
+FileListModel::FileListModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void FileListModel::setIndex(const QSharedPointer<const FileIndex> &index, const QSharedPointer<DatasetPack> &pack)
+{
+    beginResetModel();
+    files = index;
+    this->pack = pack;
+    visible.clear();
+    groups.clear();
+    agreements.clear();
+    endResetModel();
+}
+
+QSharedPointer<const FileIndex> FileListModel::fileIndex() const
+{
+    return files;
+}
+
+void FileListModel::setRows(const QVector<int> &rows)
+{
+    beginResetModel();
+    visible = rows;
+    endResetModel();
+}
+
+const QVector<int> &FileListModel::rows() const
+{
+    return visible;
+}
+
+int FileListModel::fileAt(int row) const
+{
+    return visible.value(row, -1);
+}
+
+int FileListModel::rowOf(int file) const
+{
+    return visible.indexOf(file);
+}
+
+QString FileListModel::fileName(int row) const
+{
+    if (!files || row < 0 || row >= visible.size())
+        return QString();
+    return files->absolutePath(visible[row]);
+}
+
+QStringList FileListModel::fileNames(QVector<int> *fileIndices) const
+{
+    QStringList result;
+    if (fileIndices)
+        *fileIndices = visible;
+    if (!files)
+        return result;
+    result.reserve(visible.size());
+    foreach (int file, visible)
+        result.append(files->absolutePath(file));
+    return result;
+}
+
+void FileListModel::setGroups(const QVector<int> &groupOfFile)
+{
+    groups = groupOfFile;
+    if (!visible.isEmpty())
+        emit dataChanged(index(0, GroupColumn), index(visible.size() - 1, GroupColumn));
+}
+
+int FileListModel::group(int file) const
+{
+    return groups.value(file, -1);
+}
+
+void FileListModel::setAgreements(const QHash<int, QPair<QString, QString> > &agreementOfFile)
+{
+    agreements = agreementOfFile;
+    if (!visible.isEmpty())
+        emit dataChanged(index(0, AgreementColumn), index(visible.size() - 1, AgreementColumn));
+}
+
+int FileListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : visible.size();
+}
+
+int FileListModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant FileListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || !files || index.row() >= visible.size())
+        return QVariant();
+    const int file = visible[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case NameColumn:
+            return QDir::toNativeSeparators(files->relativePath(file));
+        case SizeColumn:
+            return tr("%1 KB").arg(int((files->size(file) + 1023) / 1024));
+        case GroupColumn:
+            if (group(file) >= 0)
+                return tr("#%1").arg(group(file) + 1);
+            break;
+        case AgreementColumn:
+            if (agreements.contains(file))
+                return agreements.value(file).first;
+            break;
+        }
+        break;
+    case Qt::ToolTipRole: {
+        if (index.column() == AgreementColumn && agreements.contains(file))
+            return agreements.value(file).second;
+        QString toolTip = QDir::toNativeSeparators(files->absolutePath(file));
+        int entry = pack && index.column() == NameColumn ? pack->indexOf(files->relativePath(file)) : -1;
+        if (entry >= 0)
+            toolTip += tr(" (%1 x %2)").arg(pack->entry(entry).width).arg(pack->entry(entry).height);
+        return toolTip;
+    }
+    case Qt::TextAlignmentRole:
+        if (index.column() == SizeColumn || index.column() == AgreementColumn)
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        break;
+    case AbsoluteFileNameRole:
+        return files->absolutePath(file);
+    }
+    return QVariant();
+}
+
+QVariant FileListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+    switch (section) {
+    case NameColumn:
+        return tr("Filename");
+    case SizeColumn:
+        return tr("Size");
+    case GroupColumn:
+        return tr("Group");
+    case AgreementColumn:
+        return tr("Agreement");
+    }
+    return QVariant();
+}
@@ -0,0 +1,106 @@
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "taskscheduler.h"
+
+class DatasetPack;
+class QDataStream;
+
+// The result of one directory scan, kept in memory so the file list can be
+// filtered on every keystroke without touching the disk. All relative paths
+// share one character buffer; an entry is just two offsets and a size.
+class FileIndex
+{
+public:
+    enum MatchMode {
+        MatchAll,
+        Wildcard,           // contains * ? or [, case-insensitive like a QDir name filter
+        Substring,          // anything else, case-insensitive
+        RegularExpression   // "re:" prefix
+    };
+
+    // prefix turns a relative path into the absolute one: "<dir>/" for a
+    // directory, "<pack>.ivpk#" for a pack.
+    FileIndex(const QString &root = QString(), const QString &prefix = QString());
+
+    QString root() const;
+    int count() const;
+    void reserve(int entries, int characters);
+    void append(const QString &relativePath, qint64 size);
+    void squeeze();
+
+    QString relativePath(int i) const;
+    QString absolutePath(int i) const;
+    qint64 size(int i) const;
+    int indexOf(const QString &relativePath) const;
+    bool sameEntries(const FileIndex &other) const;
+
+    void save(QDataStream &out) const;
+    static QSharedPointer<FileIndex> load(QDataStream &in);
+
+    static MatchMode modeOf(const QString &pattern, QString *expression);
+    // Appends the entries in [begin, end) whose file name matches the pattern.
+    void match(const QString &pattern, int begin, int end, QVector<int> *result,
+               const TaskScheduler::Token &token) const;
+
+    static QSharedPointer<FileIndex> scanDirectory(const QString &root, const TaskScheduler::Token &token);
+    static QSharedPointer<FileIndex> scanPack(const QSharedPointer<DatasetPack> &pack);
+
+private:
+    QString rootPath;
+    QString prefix;
+    QString chars;
+    QVector<int> starts;        // count() + 1 offsets into chars
+    QVector<int> nameStarts;    // where the file name part of each entry begins
+    QVector<qint64> sizes;
+};
+
+// Table over the rows of a FileIndex that passed the current filter. Rows
+// are indices into the index, so refiltering never copies a path.
+class FileListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column { NameColumn, SizeColumn, GroupColumn, AgreementColumn, ColumnCount };
+    enum { AbsoluteFileNameRole = Qt::UserRole + 1 };
+
+    explicit FileListModel(QObject *parent = 0);
+
+    void setIndex(const QSharedPointer<const FileIndex> &index, const QSharedPointer<DatasetPack> &pack);
+    QSharedPointer<const FileIndex> fileIndex() const;
+    void setRows(const QVector<int> &rows);
+    const QVector<int> &rows() const;
+
+    int fileAt(int row) const;
+    int rowOf(int file) const;
+    QString fileName(int row) const;
+    QStringList fileNames(QVector<int> *fileIndices = 0) const;
+
+    // Per-file annotations survive refiltering; they are cleared with the index.
+    void setGroups(const QVector<int> &groupOfFile);
+    int group(int file) const;
+    // Text and tooltip of the agreement column, keyed by file.
+    void setAgreements(const QHash<int, QPair<QString, QString> > &agreementOfFile);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+private:
+    QSharedPointer<const FileIndex> files;
+    QSharedPointer<DatasetPack> pack;
+    QVector<int> visible;
+    QVector<int> groups;
+    QHash<int, QPair<QString, QString> > agreements;
+};
+
+#endif // FILEINDEX_H
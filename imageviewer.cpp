@@ -9,13 +9,20 @@
 #endif
 
 #include "imageviewer.h"
-
-enum { absoluteFileNameRole = Qt::UserRole + 1 };
-
-static inline QString fileNameOfItem(const QTableWidgetItem *item)
-{
-    return item->data(absoluteFileNameRole).toString();
-}
+#include "duplicatefinder.h"
+#include "cropexporter.h"
+#include "taskscheduler.h"
+#include "annotationmodel.h"
+#include "predictionindex.h"
+#include "labeldiff.h"
+#include "datasetpack.h"
+#include "fileindex.h"
+#include "session.h"
+
+// Rows filtered per task; a million files split into a few dozen tasks.
+static const int filterChunk = 16384;
+// How far a click may move when snapping, in screen pixels.
+static const double snapDistance = 8;
 
 static inline void openFile(const QString &fileName)
 {
@@ -39,6 +46,9 @@ ImageViewer::ImageViewer()
     connect(findButton, &QAbstractButton::clicked, this, &ImageViewer::find);
 
     fileComboBox = createComboBox(tr("*"));
+    fileComboBox->setToolTip(tr("Wildcards (*.jpg), plain text (matched anywhere in the name) "
+                                "or a regular expression after \"re:\""));
+    connect(fileComboBox, &QComboBox::editTextChanged, this, &ImageViewer::filterFiles);
     connect(fileComboBox->lineEdit(), &QLineEdit::returnPressed,
             this, &ImageViewer::animateFindClick);
 
@@ -47,6 +57,7 @@ ImageViewer::ImageViewer()
             this, &ImageViewer::animateFindClick);
 
     filesFoundLabel = new QLabel;
+    filesFoundLabel->setWordWrap(true);
 
     createFilesTable();
 
@@ -69,6 +80,14 @@ ImageViewer::ImageViewer()
     mainLayout->addWidget(filesTable, 2, 0);
     mainLayout->addWidget(scrollArea, 2, 1, 1, 3);
     mainLayout->addWidget(filesFoundLabel, 3, 0, 1, 2);
+
+    confidenceLabel = new QLabel;
+    confidenceSlider = new QSlider(Qt::Horizontal);
+    confidenceSlider->setRange(0, 100);
+    connect(confidenceSlider, &QSlider::valueChanged, this, &ImageViewer::confidenceChanged);
+    confidenceSlider->setValue(50);
+    mainLayout->addWidget(confidenceLabel, 3, 2);
+    mainLayout->addWidget(confidenceSlider, 3, 3);
     mainLayout->addWidget(findButton, 1, 2);
 
     window = new QWidget();
@@ -78,6 +97,22 @@ ImageViewer::ImageViewer()
     createActions();
     createMenus();
 
+    duplicateFinder = new DuplicateFinder(this);
+    connect(duplicateFinder, &DuplicateFinder::progress, this, &ImageViewer::duplicatesProgress);
+    connect(duplicateFinder, &DuplicateFinder::finished, this, &ImageViewer::duplicatesFound);
+
+    predictions = new PredictionIndex(this);
+    connect(predictions, &PredictionIndex::progress, this, &ImageViewer::predictionsProgress);
+    connect(predictions, &PredictionIndex::indexed, this, &ImageViewer::predictionsIndexed);
+
+    labelDiff = new LabelDiff(this);
+    connect(labelDiff, &LabelDiff::progress, this, &ImageViewer::diffProgress);
+    connect(labelDiff, &LabelDiff::finished, this, &ImageViewer::diffFinished);
+
+    cropExporter = new CropExporter(this);
+    connect(cropExporter, &CropExporter::progress, this, &ImageViewer::exportProgress);
+    connect(cropExporter, &CropExporter::finished, this, &ImageViewer::cropsExported);
+
     resize(QGuiApplication::primaryScreen()->availableSize() * 4 / 5);
     connect(imageLabel, SIGNAL(clicked()), this, SLOT(onclicked()));
 }
@@ -101,22 +136,8 @@ static void updateComboBox(QComboBox *comboBox)
         comboBox->addItem(comboBox->currentText());
 }
 
-static void findRecursion(const QString &path, const QString &pattern, QStringList *result)
-{
-    QDir currentDir(path);
-    const QString prefix = path + QLatin1Char('/');
-    foreach (const QString &match, currentDir.entryList(QStringList(pattern), QDir::Files | QDir::NoSymLinks))
-        result->append(prefix + match);
-    foreach (const QString &dir, currentDir.entryList(QDir::Dirs | QDir::NoSymLinks | QDir::NoDotAndDotDot))
-        findRecursion(prefix + dir, pattern, result);
-}
-
 void ImageViewer::find()
 {
-    filesTable->setRowCount(0);
-
-    QString fileName = fileComboBox->currentText();
-
     path = QDir::cleanPath(directoryComboBox->currentText());
 
     updateComboBox(fileComboBox);
@@ -125,10 +146,56 @@ void ImageViewer::find()
 
 
     currentDir = QDir(path);
-    QStringList files;
-    findRecursion(path, fileName.isEmpty() ? QStringLiteral("*") : fileName, &files);
 
-    showFiles(files);
+    // The last scan stays in memory; only a different directory goes back to disk.
+    QSharedPointer<const FileIndex> scanned = filesModel->fileIndex();
+    if (scanned && scanned->root() == path) {
+        filterFiles();
+        return;
+    }
+
+    clearFileResults();
+    filesModel->setIndex(QSharedPointer<const FileIndex>(), QSharedPointer<DatasetPack>());
+    filesFoundLabel->setText(tr("Searching..."));
+
+    // A new search supersedes any walk still running for the previous one.
+    TaskScheduler *scheduler = TaskScheduler::instance();
+    scheduler->cancel("path");
+    scheduler->cancel("filter");
+    const TaskScheduler::Token token = scheduler->token("path");
+    const QString root = path;
+
+    // A pack lists straight from its index without touching the disk.
+    pack.clear();
+    if (DatasetPack::isPackFile(path)) {
+        pack = DatasetPack::shared(path);
+        if (!pack) {
+            filesFoundLabel->setText(tr("Cannot open pack %1.").arg(QDir::toNativeSeparators(path)));
+            return;
+        }
+        showFiles(FileIndex::scanPack(pack));
+        return;
+    }
+
+    scheduler->submit(TaskScheduler::Visible, [=]() {
+        QSharedPointer<const FileIndex> index = FileIndex::scanDirectory(root, token);
+        TaskScheduler::runOnMain(this, [=]() {
+            if (!token.isCancelled())
+                showFiles(index);
+        });
+    }, token);
+}
+
+// Duplicate groups and label agreement refer to files of the current index.
+void ImageViewer::clearFileResults()
+{
+    duplicateFinder->cancel();
+    duplicateFiles.clear();
+    duplicateGroups.clear();
+    duplicateGroupOf.clear();
+    redundantDuplicates.clear();
+    labelDiff->cancel();
+    diffFiles.clear();
 }
 
 void ImageViewer::animateFindClick()
@@ -136,31 +203,66 @@ void ImageViewer::animateFindClick()
     findButton->animateClick();
 }
 
-void ImageViewer::showFiles(const QStringList &files)
-{
-    for (int i = 0; i < files.size(); ++i) {
-        const QString &fileName = files.at(i);
-        const QString toolTip = QDir::toNativeSeparators(fileName);
-        const QString relativePath = QDir::toNativeSeparators(currentDir.relativeFilePath(fileName));
-        const qint64 size = QFileInfo(fileName).size();
-        QTableWidgetItem *fileNameItem = new QTableWidgetItem(relativePath);
-        fileNameItem->setData(absoluteFileNameRole, QVariant(fileName));
-        fileNameItem->setToolTip(toolTip);
-        fileNameItem->setFlags(fileNameItem->flags() ^ Qt::ItemIsEditable);
-        QTableWidgetItem *sizeItem = new QTableWidgetItem(tr("%1 KB")
-                                             .arg(int((size + 1023) / 1024)));
-        sizeItem->setData(absoluteFileNameRole, QVariant(fileName));
-        sizeItem->setToolTip(toolTip);
-        sizeItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        sizeItem->setFlags(sizeItem->flags() ^ Qt::ItemIsEditable);
-
-        int row = filesTable->rowCount();
-        filesTable->insertRow(row);
-        filesTable->setItem(row, 0, fileNameItem);
-        filesTable->setItem(row, 1, sizeItem);
-    }
-    filesFoundLabel->setText(tr("%n file(s) found (Double click on a file to open it)", 0, files.size()));
-    filesFoundLabel->setWordWrap(true);
+void ImageViewer::showFiles(const QSharedPointer<const FileIndex> &index)
+{
+    filesModel->setIndex(index, pack);
+    filterFiles();
+}
+
+// Runs on every keystroke in the pattern box. Each chunk of the index is
+// matched on a worker; a newer keystroke cancels whatever is still running.
+void ImageViewer::filterFiles()
+{
+    const QSharedPointer<const FileIndex> index = filesModel->fileIndex();
+    if (!index)
+        return;
+    TaskScheduler *scheduler = TaskScheduler::instance();
+    scheduler->cancel("filter");
+    const TaskScheduler::Token token = scheduler->token("filter");
+    const QString pattern = fileComboBox->currentText();
+    const QBitArray skipped = skipDuplicatesAct->isChecked() ? redundantDuplicates : QBitArray();
+
+    const int total = index->count();
+    const int chunks = (total + filterChunk - 1) / filterChunk;
+    QSharedPointer<QVector<QVector<int> > > matches(new QVector<QVector<int> >(chunks));
+    QVector<int> *chunkMatches = matches->data();
+    scheduler->parallelFor(TaskScheduler::Visible, chunks, [=](int i) {
+        const int begin = i * filterChunk;
+        index->match(pattern, begin, qMin(begin + filterChunk, total), &chunkMatches[i], token);
+    }, token, [=]() {
+        if (token.isCancelled())
+            return;
+        int count = 0;
+        foreach (const QVector<int> &chunk, *matches)
+            count += chunk.size();
+        QVector<int> rows;
+        rows.reserve(count);
+        foreach (const QVector<int> &chunk, *matches) {
+            foreach (int file, chunk) {
+                // The first file of a duplicate group stays as its representative.
+                if (file >= skipped.size() || !skipped.testBit(file))
+                    rows.append(file);
+            }
+        }
+        TaskScheduler::runOnMain(this, [=]() {
+            if (token.isCancelled() || filesModel->fileIndex() != index)
+                return;
+            filesModel->setRows(rows);
+            if (pendingSelection >= 0) {
+                const int row = filesModel->rowOf(pendingSelection);
+                pendingSelection = -1;
+                if (row >= 0) {
+                    filesTable->selectRow(row);
+                    filesTable->scrollTo(filesModel->index(row, 0), QAbstractItemView::PositionAtCenter);
+                }
+            }
+            if (rows.size() == total)
+                filesFoundLabel->setText(tr("%n file(s) found (Double click on a file to open it)", 0, total));
+            else
+                filesFoundLabel->setText(tr("%1 of %n file(s) match (Double click on a file to open it)", 0, total)
+                                         .arg(rows.size()));
+        });
+    });
 }
 
 QComboBox *ImageViewer::createComboBox(const QString &text)
@@ -174,225 +276,672 @@ QComboBox *ImageViewer::createComboBox(const QString &text)
 
 void ImageViewer::createFilesTable()
 {
-    filesTable = new QTableWidget(0, 2);
+    filesModel = new FileListModel(this);
+    filesTable = new QTableView;
+    filesTable->setModel(filesModel);
     filesTable->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Preferred);
     filesTable->setMinimumWidth(100);
 
     filesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
 
-    QStringList labels;
-    labels << tr("Filename") << tr("Size");
-    filesTable->setHorizontalHeaderLabels(labels);
-    filesTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    filesTable->horizontalHeader()->setSectionResizeMode(FileListModel::NameColumn, QHeaderView::Stretch);
+    // Fixed row heights keep a million-row reset from measuring every row.
+    filesTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     filesTable->verticalHeader()->hide();
     filesTable->setShowGrid(false);
+    filesTable->setWordWrap(false);
     filesTable->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(filesTable, &QTableWidget::customContextMenuRequested,
+    connect(filesTable, &QTableView::customContextMenuRequested,
             this, &ImageViewer::contextMenu);
-    connect(filesTable, &QTableWidget::cellActivated,
+    connect(filesTable, &QTableView::activated,
             this, &ImageViewer::openFileOfItem);
-    connect(filesTable, &QTableWidget::cellClicked,
+    connect(filesTable, &QTableView::clicked,
             this, &ImageViewer::loadFileOfItem);
 }
 
 
-void ImageViewer::openFileOfItem(int row, int /* column */)
+void ImageViewer::openFileOfItem(const QModelIndex &index)
 {
-    const QTableWidgetItem *item = filesTable->item(row, 0);
-    openFile(fileNameOfItem(item));
+    openFile(filesModel->fileName(index.row()));
 }
 
 void ImageViewer::saveExit(){
-    writeObjects(image_name);
+    if (image_name != "") writeObjects();
+    saveSession();
 }
 
-void ImageViewer::loadFileOfItem(int row, int /* column */)
+void ImageViewer::saveSession()
 {
-    const QTableWidgetItem *item = filesTable->item(row, 0);
-    size_t sz = fileNameOfItem(item).split('/').size();
-    qDebug() << fileNameOfItem(item).split('/')[sz-1];
-    qDebug() << path;
-    if (image_name != "") writeObjects(image_name);
-    bool res = loadFile(fileNameOfItem(item));
-    image_name = fileNameOfItem(item).split('/')[sz-1];
-    drawObjects(image_name);
+    Session session;
+    session.directory = path.isEmpty() ? QDir::cleanPath(directoryComboBox->currentText()) : path;
+    session.pattern = fileComboBox->currentText();
+    // A pack is listed again from its own index.
+    if (!pack)
+        session.files = filesModel->fileIndex();
+    session.image = currentImage();
+    session.selectedFile = filesModel->fileAt(filesTable->currentIndex().row());
+    if (!session.image.isEmpty())
+        session.scaleFactor = scaleFactor;
+    session.fitToWindow = fitToWindowAct->isChecked();
+    session.scroll = QPoint(scrollArea->horizontalScrollBar()->value(), scrollArea->verticalScrollBar()->value());
+    if (!session.save(Session::defaultFileName()))
+        qDebug() << "saveSession: cannot write" << Session::defaultFileName();
 }
 
-void ImageViewer::drawObjects(QString &fileName){
-    QString name = "";
-    for (int i = 0; i < fileName.split('.').size()-1; i ++){
-        name = name + fileName.split('.')[i] + ".";
+// The session is read on a worker in two passes: the small header first, so
+// the last image is on screen before a large file list has been read.
+void ImageViewer::restoreSession()
+{
+    const QString fileName = Session::defaultFileName();
+    if (!QFile::exists(fileName)) {
+        emit sessionRestored();
+        return;
     }
-    name = path + "/labels/" + name + "txt";
-    qDebug() << "drawingObjects: " << name;
-    QFile inputFile(name);
-    if (inputFile.open(QIODevice::ReadOnly))
+    filesFoundLabel->setText(tr("Restoring session..."));
+    TaskScheduler::instance()->submit(TaskScheduler::Visible, [=]() {
+        QSharedPointer<Session> view(new Session);
+        if (!view->load(fileName, false)) {
+            TaskScheduler::runOnMain(this, [=]() {
+                filesFoundLabel->clear();
+                emit sessionRestored();
+            });
+            return;
+        }
+        TaskScheduler::runOnMain(this, [=]() {
+            applySession(*view);
+        });
+        QSharedPointer<Session> session(new Session);
+        session->load(fileName, true);
+        TaskScheduler::runOnMain(this, [=]() {
+            restoreFiles(*session);
+        });
+    });
+}
+
+void ImageViewer::applySession(const Session &session)
+{
     {
-        QTextStream in(&inputFile);
-        while (!in.atEnd())
-        {
-            QString line = in.readLine();
-            QStringList arr = line.split(' ');
-            xx = arr[1].toInt();
-            yy = arr[2].toInt();
-            xx1 = arr[3].toInt();
-            yy1 = arr[4].toInt();
-            xx2 = arr[5].toInt();
-            yy2 = arr[6].toInt();
-            xx3 = arr[7].toInt();
-            yy3 = arr[8].toInt();
-            vector<pair<int, int>> coord;
-            coord.push_back(make_pair(xx, yy));
-            coord.push_back(make_pair(xx1, yy1));
-            coord.push_back(make_pair(xx2, yy2));
-            coord.push_back(make_pair(xx3, yy3));
-            rects.push_back(coord);
-            objects.push_back(arr[0]);
+        // Typing has not happened yet; the list is filtered once it is in.
+        const QSignalBlocker blocker(fileComboBox);
+        fileComboBox->setEditText(session.pattern);
+        updateComboBox(fileComboBox);
+    }
+    const QString directory = QDir::toNativeSeparators(session.directory);
+    if (directoryComboBox->findText(directory) == -1)
+        directoryComboBox->addItem(directory);
+    directoryComboBox->setCurrentIndex(directoryComboBox->findText(directory));
+    path = session.directory;
+    currentDir = QDir(path);
+    pack.clear();
+    if (DatasetPack::isPackFile(path))
+        pack = DatasetPack::shared(path);
+
+    // A file that has gone away is skipped rather than reported.
+    if (!session.image.isEmpty() && DatasetPack::fileSize(session.image) > 0 && openImage(session.image)) {
+        if (session.fitToWindow) {
+            fitToWindowAct->setChecked(true);
+            fitToWindow();
+        } else if (session.scaleFactor != 1.0) {
+            scaleImage(session.scaleFactor);
         }
-        drawingRects(rects);
-        inputFile.close();
+        const QPoint scroll = session.scroll;
+        QTimer::singleShot(0, this, [=]() {
+            scrollArea->horizontalScrollBar()->setValue(scroll.x());
+            scrollArea->verticalScrollBar()->setValue(scroll.y());
+        });
+    }
+    emit sessionRestored();
+}
+
+void ImageViewer::restoreFiles(const Session &session)
+{
+    // Find was pressed for another directory while the list was loading.
+    if (path != session.directory || filesModel->fileIndex()) {
+        emit sessionRevalidated();
+        return;
+    }
+    QSharedPointer<const FileIndex> files = session.files;
+    if (pack)
+        files = FileIndex::scanPack(pack);
+    if (files && files->root() == path) {
+        pendingSelection = session.selectedFile;
+        showFiles(files);
+    } else {
+        filesFoundLabel->clear();
+    }
+    // A pack was just listed from its own index; nothing to revalidate.
+    if (session.files && !pack)
+        revalidateFiles(files);
+    else
+        emit sessionRevalidated();
+}
+
+// Rescans the restored directory at background priority and swaps the new
+// list in only if something changed, keeping the selected file.
+void ImageViewer::revalidateFiles(const QSharedPointer<const FileIndex> &restored)
+{
+    TaskScheduler *scheduler = TaskScheduler::instance();
+    scheduler->cancel("path");
+    const TaskScheduler::Token token = scheduler->token("path");
+    const QString root = path;
+    scheduler->submit(TaskScheduler::Background, [=]() {
+        QSharedPointer<const FileIndex> index = FileIndex::scanDirectory(root, token);
+        TaskScheduler::runOnMain(this, [=]() {
+            if (token.isCancelled())
+                return;
+            if (!restored || !index->sameEntries(*restored)) {
+                const QSharedPointer<const FileIndex> shown = filesModel->fileIndex();
+                const int selected = filesModel->fileAt(filesTable->currentIndex().row());
+                pendingSelection = shown && selected >= 0 ? index->indexOf(shown->relativePath(selected)) : -1;
+                clearFileResults();
+                showFiles(index);
+            }
+            emit sessionRevalidated();
+        });
+    }, token);
+}
+
+void ImageViewer::loadFileOfItem(const QModelIndex &index)
+{
+    const QString fileName = filesModel->fileName(index.row());
+    qDebug() << fileName;
+    qDebug() << path;
+    openImage(fileName);
+}
+
+bool ImageViewer::openImage(const QString &fileName)
+{
+    if (image_name != "") writeObjects();
+    bool res = loadFile(fileName);
+    image_name = fileName;
+    // Fixed now: a later find() must not move the labels of the open image.
+    image_labels = labelFileOf(fileName);
+    loadPredictions();
+    diffBoxes.clear();
+    if (!diffDir.isEmpty())
+        diffBoxes.load(DatasetPack::labelFileName(fileName, diffDir), &classes);
+    drawObjects(image_name);
+    if (!predicted.isEmpty() || !diffBoxes.isEmpty())
+        scheduleRedraw();
+    return res;
+}
+
+QString ImageViewer::currentImage() const
+{
+    return windowFilePath();
+}
+
+const AnnotationModel &ImageViewer::annotations() const
+{
+    return boxes;
+}
+
+const ClassTable &ImageViewer::classTable() const
+{
+    return classes;
+}
+
+void ImageViewer::appendBoxes(const QVector<QPoint> &corners, const QStringList &classNames)
+{
+    boxes.reserve(boxes.size() + classNames.size());
+    for (int i = 0; i < classNames.size(); i++)
+        boxes.append(corners.constData() + 4 * i, classes.intern(classNames[i]));
+    scheduleRedraw();
+}
+
+void ImageViewer::clearBoxes()
+{
+    boxes.clear();
+    boxes.setModified(true);
+    global_counter = 0;
+    scheduleRedraw();
+}
+
+bool ImageViewer::saveBoxes()
+{
+    return image_name != "" && saveObjects();
+}
+
+void ImageViewer::cancelJobs()
+{
+    duplicateFinder->cancel();
+    cropExporter->cancel();
+    predictions->cancel();
+    labelDiff->cancel();
+}
+
+QString ImageViewer::labelFileOf(const QString &fileName) const
+{
+    return DatasetPack::labelFileName(fileName, labelsDirOf(fileName));
+}
+
+// Labels of a pack live next to it, since the pack itself is read-only.
+QString ImageViewer::labelsDir() const
+{
+    if (pack)
+        return path + ".labels";
+    return path + "/labels";
+}
+
+// Images of the open dataset share its labels directory. One opened from
+// anywhere else, e.g. over the control socket, keeps its labels beside it.
+QString ImageViewer::labelsDirOf(const QString &fileName) const
+{
+    QString packFile, name;
+    if (DatasetPack::splitPath(fileName, &packFile, &name))
+        return packFile + ".labels";
+    if (!pack && !path.isEmpty()
+            && QFileInfo(fileName).absoluteFilePath().startsWith(QFileInfo(path).absoluteFilePath() + "/"))
+        return labelsDir();
+    return QFileInfo(fileName).absolutePath() + "/labels";
+}
+
+void ImageViewer::drawObjects(QString &fileName){
+    qDebug() << "drawingObjects: " << image_labels;
+    QByteArray labels;
+    if (DatasetPack::readLabels(fileName, QFileInfo(image_labels).path(), &labels)) {
+        boxes.loadData(labels, &classes);
+        drawingRects(boxes);
     }
+}
 
+// The first edge is drawn blue so the box orientation stays visible.
+static void drawBox(QPainter &painter, const QPoint *corners, const QColor &color)
+{
+    QPen paintpen(Qt::blue);
+    paintpen.setWidth(2);
+    painter.setPen(paintpen);
+    painter.drawLine(corners[0], corners[1]);
+    QPen paintpen1(color);
+    paintpen1.setWidth(2);
+    painter.setPen(paintpen1);
+    painter.drawLine(corners[1], corners[2]);
+    painter.drawLine(corners[2], corners[3]);
+    painter.drawLine(corners[0], corners[3]);
 }
 
 void ImageViewer::illumination(){
     QImage tmp(imageLabel->pixmap()->toImage());
     QPainter painter(&tmp);
-    for (int i = rects.size()-1; i < rects.size(); i++){
-        QPen paintpen(Qt::blue);
-        paintpen.setWidth(2);
-        painter.setPen(paintpen);
-        QLineF line((float)rects[i][0].first, (float)rects[i][0].second, (float)rects[i][1].first, (float)rects[i][1].second);
-        painter.drawLine(line);
-        QPen paintpen1(Qt::green);
-        paintpen1.setWidth(2);
-        painter.setPen(paintpen1);
-        for (int j = 2; j < rects[i].size(); j++){
-            QLineF line((float)rects[i][j-1].first, (float)rects[i][j-1].second, (float)rects[i][j].first, (float)rects[i][j].second);
-            painter.drawLine(line);
-        }
-        QLineF line1((float)rects[i][0].first, (float)rects[i][0].second, (float)rects[i][3].first, (float)rects[i][3].second);
-        painter.drawLine(line1);
-    }
+    if (!boxes.isEmpty())
+        drawBox(painter, boxes.corners(boxes.size() - 1), Qt::green);
+    painter.end();
     imageLabel->setPixmap(QPixmap::fromImage(tmp));
 }
 
 void ImageViewer::delight(){
     QImage tmp(imageLabel->pixmap()->toImage());
     QPainter painter(&tmp);
-
-    for (int i = rects.size()-1; i < rects.size(); i++){
-        QPen paintpen(Qt::blue);
-        paintpen.setWidth(2);
-        painter.setPen(paintpen);
-        QLineF line((float)rects[i][0].first, (float)rects[i][0].second, (float)rects[i][1].first, (float)rects[i][1].second);
-        painter.drawLine(line);
-        QPen paintpen1(Qt::red);
-        paintpen1.setWidth(2);
-        painter.setPen(paintpen1);
-        for (int j = 2; j < rects[i].size(); j++){
-            QLineF line((float)rects[i][j-1].first, (float)rects[i][j-1].second, (float)rects[i][j].first, (float)rects[i][j].second);
-            painter.drawLine(line);
-        }
-        QLineF line1((float)rects[i][0].first, (float)rects[i][0].second, (float)rects[i][3].first, (float)rects[i][3].second);
-        painter.drawLine(line1);
-    }
+    if (!boxes.isEmpty())
+        drawBox(painter, boxes.corners(boxes.size() - 1), Qt::red);
+    painter.end();
     imageLabel->setPixmap(QPixmap::fromImage(tmp));
 }
 
 
-void ImageViewer::drawingRects(vector<vector<pair<int, int> > > &rects){
-    QImage tmp(imageLabel->pixmap()->toImage());
+// Repaints every box onto a fresh copy of the original image, so undo and
+// rotation never need per-box snapshots of the whole image.
+void ImageViewer::drawingRects(const AnnotationModel &boxes){
+    QImage tmp(original.toImage());
     QPainter painter(&tmp);
-    for (int i = 0; i < rects.size(); i++){
-        images.push_back(tmp);
-        QPen paintpen(Qt::blue);
-        paintpen.setWidth(2);
-        painter.setPen(paintpen);
-        QLineF line((float)rects[i][0].first, (float)rects[i][0].second, (float)rects[i][1].first, (float)rects[i][1].second);
-        painter.drawLine(line);
-        QPen paintpen1(Qt::red);
-        paintpen1.setWidth(2);
-        painter.setPen(paintpen1);
-        for (int j = 2; j < rects[i].size(); j++){
-            QLineF line((float)rects[i][j-1].first, (float)rects[i][j-1].second, (float)rects[i][j].first, (float)rects[i][j].second);
-            painter.drawLine(line);
-        }
-        QLineF line1((float)rects[i][0].first, (float)rects[i][0].second, (float)rects[i][3].first, (float)rects[i][3].second);
-        painter.drawLine(line1);
+    for (int i = 0; i < boxes.size(); i++)
+        drawBox(painter, boxes.corners(i), i == boxes.size() - 1 ? Qt::green : Qt::red);
+    const float threshold = confidenceSlider->value() / 100.0f;
+    for (int i = 0; i < predicted.size(); i++) {
+        if (predictedScores[i] >= threshold)
+            drawBox(painter, predicted.corners(i), Qt::yellow);
     }
+    if (showDiffAct->isChecked() && !diffDir.isEmpty())
+        drawDiff(painter, boxes);
+    painter.end();
     imageLabel->setPixmap(QPixmap::fromImage(tmp));
-    illumination();
 }
 
-void ImageViewer::writeObjects(QString &fileName)
+// Matched boxes of the other set are outlined in white, reference boxes it
+// misses in magenta and boxes only it has in orange.
+void ImageViewer::drawDiff(QPainter &painter, const AnnotationModel &boxes)
 {
-    QString name = "";
-    for (int i = 0; i < fileName.split('.').size()-1; i ++){
-        name = name + fileName.split('.')[i] + ".";
+    QVector<int> referenceMatch;
+    QVector<int> otherMatch;
+    LabelDiff::match(boxes, diffBoxes, 0.5, &referenceMatch, &otherMatch);
+    QPen pen;
+    pen.setWidth(2);
+    pen.setStyle(Qt::DashLine);
+    painter.setBrush(Qt::NoBrush);
+    for (int i = 0; i < boxes.size(); i++) {
+        if (referenceMatch[i] >= 0)
+            continue;
+        pen.setColor(Qt::magenta);
+        painter.setPen(pen);
+        painter.drawPolygon(boxes.corners(i), 4);
     }
-    if (!QDir(path + "/labels").exists()){
-        QDir().mkdir(path + "/labels");
+    for (int j = 0; j < diffBoxes.size(); j++) {
+        pen.setColor(otherMatch[j] >= 0 ? QColor(Qt::white) : QColor(255, 128, 0));
+        painter.setPen(pen);
+        painter.drawPolygon(diffBoxes.corners(j), 4);
     }
+}
+
+void ImageViewer::redrawObjects()
+{
+    redrawPending = false;
+    if (!original.isNull())
+        drawingRects(boxes);
+}
+
+void ImageViewer::scheduleRedraw()
+{
+    if (redrawPending)
+        return;
+    redrawPending = true;
+    QTimer::singleShot(0, this, &ImageViewer::redrawObjects);
+}
+
+void ImageViewer::writeObjects()
+{
+    saveObjects();
+    boxes.clear();
+}
+
+// Only changed labels are written. Browsing a pack then creates no sidecar
+// files, and a rebuilt pack's labels are not shadowed by stale copies.
+bool ImageViewer::saveObjects()
+{
+    if (!boxes.isModified())
+        return true;
+    QDir().mkpath(QFileInfo(image_labels).path());
     if (file->isOpen()) file->close();
-    if (QFile(path + "/labels/" + name + "txt").exists()){
-        QFile(path + "/labels/" + name + "txt").remove();
-    }
-    file = new QFile(path + "/labels/" + name + "txt");
-    file->open(QIODevice::ReadWrite);
-    for (int i = 0; i < rects.size(); i++){
-        QString text = objects[i];
-        for (int j = 0; j < rects[i].size(); j++){
-            text = text + " " + QString::number(rects[i][j].first) + " " + QString::number(rects[i][j].second);
-        }
-        text = text + "\n";
-        QByteArray ba = text.toLatin1();
-        const char *msg = ba.data();
-        qDebug() << msg;
-        int x = file->write(msg, text.length());
-        qDebug() << x;
+    if (!boxes.save(image_labels, classes)) {
+        qDebug() << "saveObjects: cannot write" << image_labels;
+        return false;
     }
-    rects.clear();
-    objects.clear();
-    images.clear();
-    if (file->isOpen()) file->close();
+    boxes.setModified(false);
+    emit objectsSaved(windowFilePath(), image_labels);
+    return true;
 }
 
 void ImageViewer::contextMenu(const QPoint &pos)
 {
-    const QTableWidgetItem *item = filesTable->itemAt(pos);
-    if (!item)
+    const QModelIndex index = filesTable->indexAt(pos);
+    if (!index.isValid())
         return;
+    const QString fileName = filesModel->fileName(index.row());
     QMenu menu;
 #ifndef QT_NO_CLIPBOARD
     QAction *copyAction = menu.addAction("Copy Name");
 #endif
     QAction *openAction = menu.addAction("Open");
+    QAction *copyLabelsAction = 0;
+    if (duplicateGroupOf.contains(fileName))
+        copyLabelsAction = menu.addAction("Copy Labels to Duplicates");
     QAction *action = menu.exec(filesTable->mapToGlobal(pos));
     if (!action)
         return;
-    const QString fileName = fileNameOfItem(item);
     if (action == openAction)
         openFile(fileName);
+    else if (action == copyLabelsAction)
+        copyLabelsToDuplicates(fileName);
 #ifndef QT_NO_CLIPBOARD
     else if (action == copyAction)
         QGuiApplication::clipboard()->setText(QDir::toNativeSeparators(fileName));
 #endif
 }
+void ImageViewer::findDuplicates()
+{
+    const QStringList files = filesModel->fileNames(&duplicateFiles);
+    if (files.isEmpty()) {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Find some files first."));
+        return;
+    }
+    filesFoundLabel->setText(tr("Looking for duplicates..."));
+    duplicateFinder->start(files);
+}
+
+void ImageViewer::duplicatesProgress(int done, int total)
+{
+    filesFoundLabel->setText(tr("Hashing images: %1 of %2").arg(done).arg(total));
+}
+
+void ImageViewer::duplicatesFound(const QList<QStringList> &groups)
+{
+    duplicateGroups = groups;
+    duplicateGroupOf.clear();
+    int duplicates = 0;
+    for (int i = 0; i < groups.size(); i++) {
+        duplicates += groups[i].size() - 1;
+        foreach (const QString &fileName, groups[i])
+            duplicateGroupOf.insert(fileName, i);
+    }
+    showDuplicateGroups();
+    filesFoundLabel->setText(tr("%1 file(s) found, %2 near-duplicate(s) in %3 group(s)")
+                             .arg(duplicateFiles.size()).arg(duplicates).arg(groups.size()));
+}
+
+// Groups are shown per file of the index, so they survive refiltering.
+void ImageViewer::showDuplicateGroups()
+{
+    const QSharedPointer<const FileIndex> index = filesModel->fileIndex();
+    if (!index)
+        return;
+    QVector<int> groupOfFile(index->count(), -1);
+    redundantDuplicates = QBitArray(index->count());
+    foreach (int file, duplicateFiles) {
+        const QString fileName = index->absolutePath(file);
+        QHash<QString, int>::const_iterator it = duplicateGroupOf.constFind(fileName);
+        if (it == duplicateGroupOf.constEnd())
+            continue;
+        groupOfFile[file] = it.value();
+        redundantDuplicates.setBit(file, duplicateGroups[it.value()].first() != fileName);
+    }
+    filesModel->setGroups(groupOfFile);
+    if (skipDuplicatesAct->isChecked())
+        filterFiles();
+}
+
+void ImageViewer::skipDuplicates()
+{
+    filterFiles();
+}
+
+void ImageViewer::copyLabelsToDuplicates(const QString &fileName)
+{
+    const QString current = windowFilePath();
+    const QStringList &group = duplicateGroups[duplicateGroupOf.value(fileName)];
+    bool reload = image_name != "" && group.contains(current);
+    if (reload)
+        writeObjects();
+
+    // A file without labels has nothing to hand on; its duplicates keep theirs.
+    const QString source = labelFileOf(fileName);
+    QByteArray labels;
+    if (DatasetPack::readLabels(fileName, labelsDirOf(fileName), &labels)) {
+        foreach (const QString &other, group) {
+            const QString target = labelFileOf(other);
+            // Duplicates with the same stem already share the source file.
+            if (other == fileName || target == source)
+                continue;
+            QDir().mkpath(QFileInfo(target).path());
+            QFile out(target);
+            if (out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                out.write(labels);
+        }
+    }
+
+    if (reload && loadFile(current))
+        drawObjects(image_name);
+}
+
+void ImageViewer::exportCrops()
+{
+    const QStringList files = filesModel->fileNames();
+    if (files.isEmpty()) {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Find some files first."));
+        return;
+    }
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Export Crops To"), path);
+    if (directory.isEmpty())
+        return;
+    if (image_name != "")
+        saveObjects();
+    filesFoundLabel->setText(tr("Exporting crops..."));
+    cropExporter->start(files, labelsDir(), directory);
+}
+
+void ImageViewer::exportProgress(int done, int total)
+{
+    filesFoundLabel->setText(tr("Exporting crops: %1 of %2 images").arg(done).arg(total));
+}
+
+void ImageViewer::cropsExported(int crops)
+{
+    filesFoundLabel->setText(tr("%n crop(s) exported", 0, crops));
+}
+
+void ImageViewer::importPredictions()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Import Predictions"), path,
+                                                    tr("Predictions (*.csv *.jsonl *.json *.txt);;All files (*)"));
+    if (fileName.isEmpty())
+        return;
+    predicted.clear();
+    predictedScores.clear();
+    reviewedPredictions.clear();
+    scheduleRedraw();
+    filesFoundLabel->setText(tr("Indexing predictions..."));
+    predictions->open(fileName);
+}
+
+void ImageViewer::predictionsProgress(qint64 bytes, qint64 total)
+{
+    filesFoundLabel->setText(tr("Indexing predictions: %1%").arg(total > 0 ? int(100 * bytes / total) : 0));
+}
+
+void ImageViewer::predictionsIndexed(int images, qint64 count)
+{
+    filesFoundLabel->setText(tr("%1 prediction(s) for %2 image(s)").arg(count).arg(images));
+    loadPredictions();
+    scheduleRedraw();
+}
+
+void ImageViewer::loadPredictions()
+{
+    predicted.clear();
+    predictedScores.clear();
+    const QString current = currentImage();
+    if (current.isEmpty() || reviewedPredictions.contains(QFileInfo(current).fileName()))
+        return;
+    predictions->load(current, &predicted, &predictedScores, &classes);
+}
+
+void ImageViewer::confidenceChanged(int value)
+{
+    confidenceLabel->setText(tr("Confidence: %1%").arg(value));
+    if (!predicted.isEmpty())
+        scheduleRedraw();
+}
+
+// Accepted predictions become ordinary boxes; either way the image is marked
+// reviewed so its predictions are not offered again.
+void ImageViewer::acceptPredictions()
+{
+    if (predicted.isEmpty())
+        return;
+    const float threshold = confidenceSlider->value() / 100.0f;
+    for (int i = 0; i < predicted.size(); i++) {
+        if (predictedScores[i] >= threshold)
+            boxes.append(predicted.corners(i), predicted.classId(i),
+                         AnnotationModel::Edited | AnnotationModel::Predicted);
+    }
+    rejectPredictions();
+}
+
+void ImageViewer::rejectPredictions()
+{
+    if (predicted.isEmpty())
+        return;
+    reviewedPredictions.insert(QFileInfo(currentImage()).fileName());
+    predicted.clear();
+    predictedScores.clear();
+    scheduleRedraw();
+}
+
+void ImageViewer::compareLabels()
+{
+    QVector<int> fileIndices;
+    const QStringList files = filesModel->fileNames(&fileIndices);
+    if (files.isEmpty()) {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Find some files first."));
+        return;
+    }
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Compare With Labels In"), path);
+    if (directory.isEmpty())
+        return;
+    if (image_name != "")
+        saveObjects();
+    diffDir = QDir::cleanPath(directory);
+    diffBoxes.clear();
+    if (!currentImage().isEmpty())
+        diffBoxes.load(DatasetPack::labelFileName(currentImage(), diffDir), &classes);
+    showDiffAct->setEnabled(true);
+    showDiffAct->setChecked(true);
+    scheduleRedraw();
+    filesFoundLabel->setText(tr("Comparing labels..."));
+    diffFiles = fileIndices;
+    labelDiff->start(files, labelsDir(), diffDir);
+}
+
+void ImageViewer::diffProgress(int done, int total)
+{
+    filesFoundLabel->setText(tr("Comparing labels: %1 of %2").arg(done).arg(total));
+}
+
+void ImageViewer::diffFinished()
+{
+    const LabelDiff::Report &report = labelDiff->report();
+    QHash<int, QPair<QString, QString> > agreementOfFile;
+
+    // Per-image results go to the Agreement column only; a line per image in
+    // the dialog would not scale to large datasets.
+    agreementOfFile.reserve(qMin(report.images.size(), diffFiles.size()));
+    for (int i = 0; i < report.images.size() && i < diffFiles.size(); i++) {
+        const LabelDiff::Counts &counts = report.perImage[i];
+        const QString detail = tr("%1 matched, %2 missing, %3 extra")
+                .arg(counts.matched).arg(counts.missing).arg(counts.extra);
+        agreementOfFile.insert(diffFiles[i], qMakePair(tr("%1%").arg(qRound(100 * counts.agreement())), detail));
+    }
+    filesModel->setAgreements(agreementOfFile);
+
+    QString summary = tr("Overall agreement %1% (%2 matched, %3 missing, %4 extra)\n")
+            .arg(qRound(100 * report.total.agreement()))
+            .arg(report.total.matched).arg(report.total.missing).arg(report.total.extra);
+    QMap<QString, LabelDiff::Counts>::const_iterator it;
+    for (it = report.perClass.constBegin(); it != report.perClass.constEnd(); ++it) {
+        summary += tr("\n%1: %2% (%3 matched, %4 missing, %5 extra)")
+                .arg(it.key()).arg(qRound(100 * it.value().agreement()))
+                .arg(it.value().matched).arg(it.value().missing).arg(it.value().extra);
+    }
+    filesFoundLabel->setText(tr("Overall agreement %1%").arg(qRound(100 * report.total.agreement())));
+
+    QMessageBox::information(this, tr("Label Comparison"), summary);
+}
+
 void ImageViewer::onclicked(){
     qDebug() << imageLabel->ev->x();
     qDebug() << imageLabel->ev->y();
 
+    const QPoint point = clickedPoint();
     if (global_counter == 0){
-        xx = imageLabel->ev->x() / scaleFactor;
-        yy = imageLabel->ev->y() / scaleFactor;
+        xx = point.x();
+        yy = point.y();
         global_counter++;
     } else if (global_counter == 1){
-        xx1 = imageLabel->ev->x() / scaleFactor;
-        yy1 = imageLabel->ev->y() / scaleFactor;
+        xx1 = point.x();
+        yy1 = point.y();
         delight();
         QImage tmp(imageLabel->pixmap()->toImage());
-        images.push_back(tmp);
         QPainter painter(&tmp);
         QPen paintpen(Qt::blue);
         paintpen.setWidth(2);
@@ -402,8 +951,8 @@ void ImageViewer::onclicked(){
         imageLabel->setPixmap(QPixmap::fromImage(tmp));
         global_counter++;
     }else{
-        xx2 = imageLabel->ev->x() / scaleFactor;
-        yy2 = imageLabel->ev->y() / scaleFactor;
+        xx2 = point.x();
+        yy2 = point.y();
 
         int a1 = yy - yy1;
         int b1 = xx1 - xx;
@@ -432,12 +981,8 @@ void ImageViewer::onclicked(){
         xx3 = -(cc1 * bb2 - cc2 * bb1)/(aa1 * bb2 - aa2 * bb1);
 
 
-        vector<pair<int, int>> coord;
-        coord.push_back(make_pair(xx, yy));
-        coord.push_back(make_pair(xx1, yy1));
-        coord.push_back(make_pair(xx2, yy2));
-        coord.push_back(make_pair(xx3, yy3));
-        rects.push_back(coord);
+        const QPoint corners[4] = { QPoint(xx, yy), QPoint(xx1, yy1), QPoint(xx2, yy2), QPoint(xx3, yy3) };
+        boxes.append(corners, classes.intern(lineEdit->text()));
 
         QImage tmp(imageLabel->pixmap()->toImage());
 
@@ -455,29 +1000,44 @@ void ImageViewer::onclicked(){
 
         imageLabel->setPixmap(QPixmap::fromImage(tmp));
         global_counter = 0;
-        QString text = lineEdit->text();
-        objects.push_back(text);
         //prev = tmp;
         illumination();
     }
 }
 
+// The click in image coordinates, optionally moved onto the strongest corner
+// or edge within a few screen pixels, however far the image is zoomed.
+// Mapped through the label's actual size, like the loupe, because Fit to
+// Window stretches the label without touching scaleFactor.
+QPoint ImageViewer::clickedPoint()
+{
+    const double sx = double(original.width()) / qMax(1, imageLabel->width());
+    const double sy = double(original.height()) / qMax(1, imageLabel->height());
+    const QPoint imagePos(int(imageLabel->ev->x() * sx), int(imageLabel->ev->y() * sy));
+    if (!snapAct->isChecked())
+        return imagePos;
+    const int radius = qBound(2, qCeil(snapDistance * qMax(sx, sy)), 32);
+    return snapper.snap(imagePos, radius);
+}
+
 bool ImageViewer::loadFile(const QString &fileName)
 {
-    QImageReader reader(fileName);
-    reader.setAutoTransform(true);
-    QImage image = reader.read();
+    QImage image = DatasetPack::readImage(fileName);
     if (image.isNull()) {
         QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
                                  tr("Cannot load %1.").arg(QDir::toNativeSeparators(fileName)));
         setWindowFilePath(QString());
         imageLabel->setPixmap(QPixmap());
+        imageLabel->setSource(QPixmap());
+        snapper.clear();
         imageLabel->adjustSize();
         return false;
     }
     QPixmap pix = QPixmap::fromImage(image);
     imageLabel->setPixmap(pix);
     original = QPixmap::fromImage(image);
+    imageLabel->setSource(original);
+    snapper.setImage(original);
 
     scaleFactor = 1.0;
     printAct->setEnabled(true);
@@ -547,47 +1107,22 @@ void ImageViewer::normalSize()
 void ImageViewer::deleteRect()
 {
     qDebug()<< "deleteRect" <<  global_counter;
-    if (!rects.empty()){
-        imageLabel->setPixmap(QPixmap::fromImage(images.back()));
-        if (global_counter == 0){
-            rects.pop_back();
-            objects.pop_back();
-            images.pop_back();
-        }else{
-            global_counter = 0;
-            images.pop_back();
-        }
-        illumination();
-        if (!objects.empty()) lineEdit->setText(objects.back());
-
+    if (global_counter != 0){
+        global_counter = 0;
+        drawingRects(boxes);
+    }else if (!boxes.isEmpty()){
+        boxes.removeLast();
+        drawingRects(boxes);
+        if (!boxes.isEmpty()) lineEdit->setText(classes.name(boxes.classId(boxes.size() - 1)));
     }
 }
 
 void ImageViewer::rotateRect()
 {
-    if (!rects.empty() && global_counter == 0){
+    if (!boxes.isEmpty() && global_counter == 0){
         qDebug()<< "rotateRect";
-        QImage tmp = images.back();
-        QPainter painter(&tmp);
-        QPen paintpen(Qt::blue);
-        paintpen.setWidth(2);
-        painter.setPen(paintpen);
-        vector<pair<int, int>> coord = rects.back();
-        rects.pop_back();
-        rotate(coord.begin(), coord.begin() + 1, coord.end());
-        QLineF line((float)coord[0].first, (float)coord[0].second, (float)coord[1].first, (float)coord[1].second);
-        painter.drawLine(line);
-        QPen paintpen1(Qt::green);
-        paintpen1.setWidth(2);
-        painter.setPen(paintpen1);
-        for (int j = 2; j < coord.size(); j++){
-            QLineF line((float)coord[j-1].first, (float)coord[j-1].second, (float)coord[j].first, (float)coord[j].second);
-            painter.drawLine(line);
-        }
-        QLineF line1((float)coord[0].first, (float)coord[0].second, (float)coord[3].first, (float)coord[3].second);
-        painter.drawLine(line1);
-        rects.push_back(coord);
-        imageLabel->setPixmap(QPixmap::fromImage(tmp));
+        boxes.rotateLast();
+        drawingRects(boxes);
     }
 }
 
@@ -630,6 +1165,38 @@ void ImageViewer::createActions()
     printAct->setEnabled(false);
     connect(printAct, SIGNAL(triggered()), this, SLOT(print()));
 
+    findDuplicatesAct = new QAction(tr("Find &Duplicates"), this);
+    findDuplicatesAct->setShortcut(tr("Ctrl+D"));
+    connect(findDuplicatesAct, SIGNAL(triggered()), this, SLOT(findDuplicates()));
+
+    importPredictionsAct = new QAction(tr("Import P&redictions..."), this);
+    connect(importPredictionsAct, SIGNAL(triggered()), this, SLOT(importPredictions()));
+
+    acceptPredictionsAct = new QAction(tr("&Accept Predictions"), this);
+    acceptPredictionsAct->setShortcut(tr("A"));
+    connect(acceptPredictionsAct, SIGNAL(triggered()), this, SLOT(acceptPredictions()));
+    window->addAction(acceptPredictionsAct);
+
+    rejectPredictionsAct = new QAction(tr("Re&ject Predictions"), this);
+    rejectPredictionsAct->setShortcut(tr("J"));
+    connect(rejectPredictionsAct, SIGNAL(triggered()), this, SLOT(rejectPredictions()));
+    window->addAction(rejectPredictionsAct);
+
+    compareLabelsAct = new QAction(tr("Compare &Labels..."), this);
+    connect(compareLabelsAct, SIGNAL(triggered()), this, SLOT(compareLabels()));
+
+    showDiffAct = new QAction(tr("Show &Label Diff"), this);
+    showDiffAct->setCheckable(true);
+    showDiffAct->setEnabled(false);
+    connect(showDiffAct, SIGNAL(triggered()), this, SLOT(redrawObjects()));
+
+    exportCropsAct = new QAction(tr("Export &Crops..."), this);
+    connect(exportCropsAct, SIGNAL(triggered()), this, SLOT(exportCrops()));
+
+    skipDuplicatesAct = new QAction(tr("&Skip Duplicates"), this);
+    skipDuplicatesAct->setCheckable(true);
+    connect(skipDuplicatesAct, SIGNAL(triggered()), this, SLOT(skipDuplicates()));
+
     exitAct = new QAction(tr("E&xit"), this);
     exitAct->setShortcut(tr("Ctrl+Q"));
     connect(exitAct, SIGNAL(triggered()), this, SLOT(close()));
@@ -655,6 +1222,17 @@ void ImageViewer::createActions()
     fitToWindowAct->setShortcut(tr("Ctrl+F"));
     connect(fitToWindowAct, SIGNAL(triggered()), this, SLOT(fitToWindow()));
 
+    loupeAct = new QAction(tr("&Loupe"), this);
+    loupeAct->setCheckable(true);
+    loupeAct->setShortcut(tr("L"));
+    connect(loupeAct, SIGNAL(toggled(bool)), imageLabel, SLOT(setLoupeEnabled(bool)));
+    window->addAction(loupeAct);
+
+    snapAct = new QAction(tr("S&nap to Edges"), this);
+    snapAct->setCheckable(true);
+    snapAct->setShortcut(tr("N"));
+    window->addAction(snapAct);
+
     aboutAct = new QAction(tr("&About"), this);
     connect(aboutAct, SIGNAL(triggered()), this, SLOT(about()));
 
@@ -667,6 +1245,10 @@ void ImageViewer::createMenus()
     fileMenu = new QMenu(tr("&File"), this);
     fileMenu->addAction(openAct);
     fileMenu->addAction(printAct);
+    fileMenu->addAction(findDuplicatesAct);
+    fileMenu->addAction(exportCropsAct);
+    fileMenu->addAction(importPredictionsAct);
+    fileMenu->addAction(compareLabelsAct);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAct);
 
@@ -676,6 +1258,10 @@ void ImageViewer::createMenus()
     window->addAction(normalSizeAct);
     viewMenu->addSeparator();
     viewMenu->addAction(fitToWindowAct);
+    viewMenu->addAction(loupeAct);
+    viewMenu->addAction(snapAct);
+    viewMenu->addAction(skipDuplicatesAct);
+    viewMenu->addAction(showDiffAct);
 
     helpMenu = new QMenu(tr("&Help"), this);
     helpMenu->addAction(aboutAct);
@@ -4,6 +4,12 @@
 #include <QWidget>
 #include <QDir>
 #include <QMainWindow>
+#include <QBitArray>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include "annotationmodel.h"
+#include "edgesnapper.h"
 #ifndef QT_NO_PRINTER
 #include <QPrinter>
 #include <QTouchEvent>
@@ -16,8 +22,8 @@ using namespace std;
 
 QT_BEGIN_NAMESPACE
 class QComboBox;
-class QTableWidget;
-class QTableWidgetItem;
+class QTableView;
+class QModelIndex;
 class QAction;
 class QLabel;
 class QMenu;
@@ -26,8 +32,18 @@ class QScrollBar;
 class QPushButton;
 class QLineEdit;
 class QPainter;
+class QSlider;
 QT_END_NAMESPACE
 
+class DuplicateFinder;
+class CropExporter;
+class PredictionIndex;
+class LabelDiff;
+class DatasetPack;
+class FileIndex;
+class FileListModel;
+struct Session;
+
 class ImageViewer : public QMainWindow
 {
     Q_OBJECT
@@ -36,6 +52,27 @@ public:
     ImageViewer();
     bool loadFile(const QString &);
 
+    // Used by the control server; the redraw is deferred so batches coalesce.
+    bool openImage(const QString &fileName);
+    QString currentImage() const;
+    const AnnotationModel &annotations() const;
+    const ClassTable &classTable() const;
+    void appendBoxes(const QVector<QPoint> &corners, const QStringList &classNames);
+    void clearBoxes();
+    bool saveBoxes();
+    // Stops every background job so the scheduler can shut down promptly.
+    void cancelJobs();
+
+public slots:
+    // Reopens the directory, image and view of the last run; the file list is
+    // rescanned in the background afterwards.
+    void restoreSession();
+
+signals:
+    void objectsSaved(const QString &imageFile, const QString &labelFile);
+    void sessionRestored();
+    void sessionRevalidated();
+
 protected:
     //void mousePressEvent(QMouseEvent * event);
 private slots:
@@ -53,28 +90,80 @@ private slots:
     void browse();
     void find();
     void animateFindClick();
-    void openFileOfItem(int row, int column);
-    void loadFileOfItem(int row, int column);
+    void filterFiles();
+    void openFileOfItem(const QModelIndex &index);
+    void loadFileOfItem(const QModelIndex &index);
     void contextMenu(const QPoint &pos);
     void saveExit();
+    void redrawObjects();
+    void importPredictions();
+    void predictionsProgress(qint64 bytes, qint64 total);
+    void predictionsIndexed(int images, qint64 count);
+    void confidenceChanged(int value);
+    void acceptPredictions();
+    void rejectPredictions();
+    void compareLabels();
+    void diffProgress(int done, int total);
+    void diffFinished();
+    void findDuplicates();
+    void duplicatesProgress(int done, int total);
+    void duplicatesFound(const QList<QStringList> &groups);
+    void skipDuplicates();
+    void exportCrops();
+    void exportProgress(int done, int total);
+    void cropsExported(int crops);
 
 private:
     QStringList findFiles(const QStringList &files, const QString &text);
-    void showFiles(const QStringList &files);
+    void showFiles(const QSharedPointer<const FileIndex> &index);
+    void clearFileResults();
+    void saveSession();
+    void applySession(const Session &session);
+    void restoreFiles(const Session &session);
+    void revalidateFiles(const QSharedPointer<const FileIndex> &restored);
     QComboBox *createComboBox(const QString &text = QString());
     void createFilesTable();
-    void writeObjects(QString &fileName);
+    // Both write to image_labels, the label file chosen when the image was opened.
+    void writeObjects();
+    bool saveObjects();
     void drawObjects(QString &fileName);
-    void drawingRects(vector< vector< pair<int, int> > > &rects);
+    void drawingRects(const AnnotationModel &boxes);
+    void scheduleRedraw();
+    void loadPredictions();
+    void drawDiff(QPainter &painter, const AnnotationModel &boxes);
+    QString labelFileOf(const QString &fileName) const;
+    QString labelsDir() const;
+    QString labelsDirOf(const QString &fileName) const;
+    void copyLabelsToDuplicates(const QString &fileName);
+    void showDuplicateGroups();
 
     QComboBox *fileComboBox;
     QComboBox *textComboBox;
     QComboBox *directoryComboBox;
     QLabel *filesFoundLabel;
     QPushButton *findButton;
-    QTableWidget *filesTable;
+    QTableView *filesTable;
+    FileListModel *filesModel;
+    int pendingSelection = -1;
+    DuplicateFinder *duplicateFinder;
+    QVector<int> duplicateFiles;
+    QHash<QString, int> duplicateGroupOf;
+    QList<QStringList> duplicateGroups;
+    QBitArray redundantDuplicates;
+    CropExporter *cropExporter;
+    PredictionIndex *predictions;
+    AnnotationModel predicted;
+    QVector<float> predictedScores;
+    QSet<QString> reviewedPredictions;
+    QLabel *confidenceLabel;
+    QSlider *confidenceSlider;
+    LabelDiff *labelDiff;
+    QVector<int> diffFiles;
+    QString diffDir;
+    AnnotationModel diffBoxes;
 
     QDir currentDir;
+    QSharedPointer<DatasetPack> pack;
     void createActions();
     void createMenus();
     void updateActions();
@@ -82,12 +171,14 @@ private:
     void adjustScrollBar(QScrollBar *scrollBar, double factor);
     void illumination();
     void delight();
+    QPoint clickedPoint();
 
     int global_counter = 0;
     int kol_photo = 55;
     ClickableLabel *imageLabel;
     QScrollArea *scrollArea;
     QPixmap original;
+    EdgeSnapper snapper;
     int xx;
     int yy;
     int xx1;
@@ -97,11 +188,12 @@ private:
     int xx3;
     int yy3;
     QImage prev;
-    vector< vector< pair<int, int> > > rects;
-    vector<QImage> images;
-    vector<QString> objects;
+    AnnotationModel boxes;
+    ClassTable classes;
+    bool redrawPending = false;
     QString path;
     QString image_name;
+    QString image_labels;
 
     double scaleFactor;
     QFile *file = new QFile("hah");
@@ -122,11 +214,21 @@ private:
     QAction *deleteAct;
     QAction *rotateAct;
     QAction *printAct;
+    QAction *findDuplicatesAct;
+    QAction *skipDuplicatesAct;
+    QAction *exportCropsAct;
+    QAction *importPredictionsAct;
+    QAction *acceptPredictionsAct;
+    QAction *rejectPredictionsAct;
+    QAction *compareLabelsAct;
+    QAction *showDiffAct;
     QAction *exitAct;
     QAction *zoomInAct;
     QAction *zoomOutAct;
     QAction *normalSizeAct;
     QAction *fitToWindowAct;
+    QAction *loupeAct;
+    QAction *snapAct;
     QAction *aboutAct;
     QAction *aboutQtAct;
 
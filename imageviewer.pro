@@ -1,11 +1,34 @@
-QT += widgets gui core
+QT += widgets gui core network
+CONFIG += c++11
 qtHaveModule(printsupport): QT += printsupport
 
 HEADERS       = imageviewer.h \
-                clickablelabel.h
+                clickablelabel.h \
+                duplicatefinder.h \
+                cropexporter.h \
+                taskscheduler.h \
+                annotationmodel.h \
+                controlserver.h \
+                predictionindex.h \
+                labeldiff.h \
+                datasetpack.h \
+                fileindex.h \
+                edgesnapper.h \
+                session.h
 SOURCES       = imageviewer.cpp \
                 main.cpp \
-                clickablelabel.cpp
+                clickablelabel.cpp \
+                duplicatefinder.cpp \
+                cropexporter.cpp \
+                taskscheduler.cpp \
+                annotationmodel.cpp \
+                controlserver.cpp \
+                predictionindex.cpp \
+                labeldiff.cpp \
+                datasetpack.cpp \
+                fileindex.cpp \
+                edgesnapper.cpp \
+                session.cpp
 
 # install
 target.path = $$[QT_INSTALL_EXAMPLES]/widgets/widgets/imageviewer
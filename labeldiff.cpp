@@ -0,0 +1,253 @@
+#include "labeldiff.h"
+#include "annotationmodel.h"
+#include "datasetpack.h"
+
+#include <QFileInfo>
+#include <QPointF>
+#include <QPointer>
+#include <QSharedPointer>
+#include <algorithm>
+
+namespace {
+
+struct Candidate {
+    double iou;
+    int reference;
+    int other;
+};
+
+static double cross(const QPointF &o, const QPointF &a, const QPointF &b)
+{
+    return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+}
+
+static double signedArea(const QPointF *p, int n)
+{
+    double area = 0;
+    for (int i = 0; i < n; i++) {
+        const QPointF &a = p[i];
+        const QPointF &b = p[(i + 1) % n];
+        area += a.x() * b.y() - b.x() * a.y();
+    }
+    return area / 2;
+}
+
+static QPointF intersection(const QPointF &from, const QPointF &to, double dFrom, double dTo)
+{
+    return from + (to - from) * (dFrom / (dFrom - dTo));
+}
+
+static LabelDiff::Counts diffImage(const QString &image, const QString &referenceDir, const QString &otherDir,
+                                   double threshold, QMap<QString, LabelDiff::Counts> *perClass)
+{
+    // The reference side is the dataset itself, so packed labels count there.
+    ClassTable classes;
+    AnnotationModel reference;
+    AnnotationModel other;
+    QByteArray labels;
+    if (DatasetPack::readLabels(image, referenceDir, &labels))
+        reference.loadData(labels, &classes);
+    other.load(DatasetPack::labelFileName(image, otherDir), &classes);
+
+    QVector<int> referenceMatch;
+    QVector<int> otherMatch;
+    LabelDiff::match(reference, other, threshold, &referenceMatch, &otherMatch);
+
+    LabelDiff::Counts counts;
+    for (int i = 0; i < reference.size(); i++) {
+        LabelDiff::Counts &c = (*perClass)[classes.name(reference.classId(i))];
+        if (referenceMatch[i] >= 0) {
+            counts.matched++;
+            c.matched++;
+        } else {
+            counts.missing++;
+            c.missing++;
+        }
+    }
+    for (int j = 0; j < other.size(); j++) {
+        if (otherMatch[j] < 0) {
+            counts.extra++;
+            (*perClass)[classes.name(other.classId(j))].extra++;
+        }
+    }
+    return counts;
+}
+
+}
+
+double LabelDiff::Counts::agreement() const
+{
+    int all = matched + missing + extra;
+    return all == 0 ? 1.0 : double(matched) / all;
+}
+
+LabelDiff::Counts &LabelDiff::Counts::operator+=(const Counts &other)
+{
+    matched += other.matched;
+    missing += other.missing;
+    extra += other.extra;
+    return *this;
+}
+
+LabelDiff::LabelDiff(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LabelDiff::~LabelDiff()
+{
+    cancel();
+}
+
+void LabelDiff::start(const QStringList &images, const QString &referenceDir, const QString &otherDir,
+                      double threshold)
+{
+    cancel();
+    token = TaskScheduler::Token();
+    result = Report();
+
+    const TaskScheduler::Token token = this->token;
+    const int total = images.size();
+    QSharedPointer<QVector<Counts> > perImage(new QVector<Counts>(total));
+    QSharedPointer<QVector<QMap<QString, Counts> > > perImageClasses(new QVector<QMap<QString, Counts> >(total));
+    Counts *imageCounts = perImage->data();
+    QMap<QString, Counts> *imageClasses = perImageClasses->data();
+    QSharedPointer<QAtomicInt> done(new QAtomicInt(0));
+    QPointer<LabelDiff> self(this);
+    TaskScheduler::instance()->parallelFor(TaskScheduler::Background, total, [=](int i) {
+        imageCounts[i] = diffImage(images.at(i), referenceDir, otherDir, threshold, &imageClasses[i]);
+        TaskScheduler::postProgress(self, token, done->fetchAndAddRelaxed(1) + 1, total, [self](int count, int total) {
+            emit self->progress(count, total);
+        });
+    }, token, [=]() {
+        if (token.isCancelled())
+            return;
+        Report report;
+        report.images = images;
+        report.perImage = *perImage;
+        for (int i = 0; i < total; i++) {
+            report.total += imageCounts[i];
+            QMap<QString, Counts>::const_iterator it;
+            for (it = imageClasses[i].constBegin(); it != imageClasses[i].constEnd(); ++it)
+                report.perClass[it.key()] += it.value();
+        }
+        TaskScheduler::runOnMain(self, [=]() {
+            if (token.isCancelled())
+                return;
+            self->result = report;
+            emit self->finished();
+        });
+    });
+}
+
+void LabelDiff::cancel()
+{
+    token.cancel();
+}
+
+const LabelDiff::Report &LabelDiff::report() const
+{
+    return result;
+}
+
+// Both models must have been loaded with the same ClassTable.
+void LabelDiff::match(const AnnotationModel &reference, const AnnotationModel &other, double threshold,
+                      QVector<int> *referenceMatch, QVector<int> *otherMatch)
+{
+    const int referenceCount = reference.size();
+    const int otherCount = other.size();
+    referenceMatch->fill(-1, referenceCount);
+    otherMatch->fill(-1, otherCount);
+    if (referenceCount == 0 || otherCount == 0)
+        return;
+
+    QVector<float> bounds(4 * otherCount);
+    float *minX = bounds.data();
+    float *minY = minX + otherCount;
+    float *maxX = minY + otherCount;
+    float *maxY = maxX + otherCount;
+    for (int j = 0; j < otherCount; j++) {
+        const QPoint *c = other.corners(j);
+        minX[j] = qMin(qMin(c[0].x(), c[1].x()), qMin(c[2].x(), c[3].x()));
+        minY[j] = qMin(qMin(c[0].y(), c[1].y()), qMin(c[2].y(), c[3].y()));
+        maxX[j] = qMax(qMax(c[0].x(), c[1].x()), qMax(c[2].x(), c[3].x()));
+        maxY[j] = qMax(qMax(c[0].y(), c[1].y()), qMax(c[2].y(), c[3].y()));
+    }
+
+    QVector<uchar> overlapMask(otherCount);
+    uchar *overlaps = overlapMask.data();
+    QVector<Candidate> candidates;
+    for (int i = 0; i < referenceCount; i++) {
+        const QPoint *c = reference.corners(i);
+        const float x0 = qMin(qMin(c[0].x(), c[1].x()), qMin(c[2].x(), c[3].x()));
+        const float y0 = qMin(qMin(c[0].y(), c[1].y()), qMin(c[2].y(), c[3].y()));
+        const float x1 = qMax(qMax(c[0].x(), c[1].x()), qMax(c[2].x(), c[3].x()));
+        const float y1 = qMax(qMax(c[0].y(), c[1].y()), qMax(c[2].y(), c[3].y()));
+        // Branch-free so the compiler can vectorize the test over all boxes.
+        for (int j = 0; j < otherCount; j++)
+            overlaps[j] = (minX[j] < x1) & (maxX[j] > x0) & (minY[j] < y1) & (maxY[j] > y0);
+        for (int j = 0; j < otherCount; j++) {
+            if (!overlaps[j] || other.classId(j) != reference.classId(i))
+                continue;
+            const double iou = rotatedIoU(c, other.corners(j));
+            if (iou >= threshold) {
+                Candidate candidate = { iou, i, j };
+                candidates.append(candidate);
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.iou > b.iou;
+    });
+    foreach (const Candidate &candidate, candidates) {
+        if ((*referenceMatch)[candidate.reference] >= 0 || (*otherMatch)[candidate.other] >= 0)
+            continue;
+        (*referenceMatch)[candidate.reference] = candidate.other;
+        (*otherMatch)[candidate.other] = candidate.reference;
+    }
+}
+
+// Clips quad a against each edge of quad b (Sutherland-Hodgman); both are
+// treated as convex, which holds for the rectangles drawn in the viewer.
+double LabelDiff::rotatedIoU(const QPoint *a, const QPoint *b)
+{
+    QPointF subject[64];
+    QPointF clipped[64];
+    QPointF clip[4];
+    for (int j = 0; j < 4; j++) {
+        subject[j] = a[j];
+        clip[j] = b[j];
+    }
+    const double areaA = qAbs(signedArea(subject, 4));
+    const double areaB = signedArea(clip, 4);
+    if (areaA <= 0 || areaB == 0)
+        return 0;
+    const double orientation = areaB > 0 ? 1 : -1;
+
+    int n = 4;
+    for (int e = 0; e < 4 && n > 0; e++) {
+        const QPointF &p = clip[e];
+        const QPointF &q = clip[(e + 1) % 4];
+        int m = 0;
+        for (int i = 0; i < n && m < 62; i++) {
+            const QPointF &current = subject[i];
+            const QPointF &previous = subject[(i + n - 1) % n];
+            const double dCurrent = orientation * cross(p, q, current);
+            const double dPrevious = orientation * cross(p, q, previous);
+            if (dCurrent >= 0) {
+                if (dPrevious < 0)
+                    clipped[m++] = intersection(previous, current, dPrevious, dCurrent);
+                clipped[m++] = current;
+            } else if (dPrevious >= 0) {
+                clipped[m++] = intersection(previous, current, dPrevious, dCurrent);
+            }
+        }
+        std::copy(clipped, clipped + m, subject);
+        n = m;
+    }
+    if (n < 3)
+        return 0;
+    const double intersectionArea = qAbs(signedArea(subject, n));
+    return intersectionArea / (areaA + qAbs(areaB) - intersectionArea);
+}
@@ -0,0 +1,59 @@
+#ifndef LABELDIFF_H
+#define LABELDIFF_H
+
+#include <QObject>
+#include <QMap>
+#include <QPoint>
+#include <QStringList>
+#include <QVector>
+
+#include "taskscheduler.h"
+
+class AnnotationModel;
+
+// Compares two label sets box by box. Boxes of the same class are paired
+// greedily by rotated-polygon IoU; an axis-aligned overlap test over flat
+// coordinate arrays rules out most pairs before any polygon is clipped.
+class LabelDiff : public QObject
+{
+    Q_OBJECT
+public:
+    struct Counts {
+        Counts() : matched(0), missing(0), extra(0) {}
+        int matched;    // in both sets
+        int missing;    // only in the reference set
+        int extra;      // only in the other set
+        double agreement() const;
+        Counts &operator+=(const Counts &other);
+    };
+
+    struct Report {
+        QStringList images;
+        QVector<Counts> perImage;
+        QMap<QString, Counts> perClass;
+        Counts total;
+    };
+
+    explicit LabelDiff(QObject *parent = 0);
+    ~LabelDiff();
+
+    void start(const QStringList &images, const QString &referenceDir, const QString &otherDir,
+               double threshold = 0.5);
+    void cancel();
+    const Report &report() const;
+
+    // referenceMatch[i] is the other-set box matched to reference box i, or -1.
+    static void match(const AnnotationModel &reference, const AnnotationModel &other, double threshold,
+                      QVector<int> *referenceMatch, QVector<int> *otherMatch);
+    static double rotatedIoU(const QPoint *a, const QPoint *b);
+
+signals:
+    void progress(int done, int total);
+    void finished();
+
+private:
+    TaskScheduler::Token token;
+    Report result;
+};
+
+#endif // LABELDIFF_H
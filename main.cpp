@@ -1,23 +1,142 @@
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QTextStream>
+#include <QTimer>
 
 #include "imageviewer.h"
+#include "cropexporter.h"
+#include "taskscheduler.h"
+#include "controlserver.h"
+#include "datasetpack.h"
+
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (!qstrcmp(argv[i], "--export-crops") || !qstrcmp(argv[i], "--build-pack"))
+            return true;
+    }
+    return false;
+}
+
+static int runHeadless()
+{
+    QCommandLineParser commandLineParser;
+    commandLineParser.addHelpOption();
+    QCommandLineOption exportCropsOption("export-crops",
+        QCoreApplication::translate("main", "Export labelled objects of <directory> as upright crops into <output>."),
+        QCoreApplication::translate("main", "output"));
+    commandLineParser.addOption(exportCropsOption);
+    QCommandLineOption buildPackOption("build-pack",
+        QCoreApplication::translate("main", "Pack the images and labels of <directory> into <pack>."),
+        QCoreApplication::translate("main", "pack"));
+    commandLineParser.addOption(buildPackOption);
+    QCommandLineOption patternOption("pattern",
+        QCoreApplication::translate("main", "File name pattern of the images."),
+        QCoreApplication::translate("main", "pattern"), QStringLiteral("*"));
+    commandLineParser.addOption(patternOption);
+    commandLineParser.addPositionalArgument(QCoreApplication::translate("main", "directory"),
+        QCoreApplication::translate("main", "Dataset directory with a labels/ subdirectory, or a pack."));
+    commandLineParser.process(QCoreApplication::arguments());
+    if (commandLineParser.positionalArguments().isEmpty())
+        commandLineParser.showHelp(1);
+
+    const QString directory = QDir::cleanPath(commandLineParser.positionalArguments().front());
+    if (commandLineParser.isSet(buildPackOption)) {
+        QString error;
+        if (!DatasetPack::build(directory, commandLineParser.value(buildPackOption), &error)) {
+            QTextStream(stderr) << "Cannot build pack: " << error << "\n";
+            return 1;
+        }
+        if (!commandLineParser.isSet(exportCropsOption))
+            return 0;
+    }
+
+    QString labelsDir = directory + "/labels";
+    QStringList images;
+    if (DatasetPack::isPackFile(directory)) {
+        QSharedPointer<DatasetPack> pack = DatasetPack::shared(directory);
+        if (!pack) {
+            QTextStream(stderr) << "Cannot open pack " << directory << "\n";
+            return 1;
+        }
+        labelsDir = directory + ".labels";
+        QRegExp matcher(commandLineParser.value(patternOption), Qt::CaseInsensitive, QRegExp::Wildcard);
+        for (int i = 0; i < pack->count(); i++) {
+            if (matcher.exactMatch(QFileInfo(pack->entry(i).name).fileName()))
+                images.append(pack->pathOf(i));
+        }
+    } else {
+        QDirIterator it(directory, QStringList(commandLineParser.value(patternOption)),
+                        QDir::Files | QDir::NoSymLinks, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString fileName = it.next();
+            if (it.fileInfo().path() != labelsDir)
+                images.append(fileName);
+        }
+    }
+
+    int crops = CropExporter::exportAll(images, labelsDir, commandLineParser.value(exportCropsOption));
+    QTextStream(stdout) << crops << " crop(s) exported from " << images.size() << " file(s)\n";
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startup;
+    startup.start();
+
+    if (isHeadless(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        int result = runHeadless();
+        TaskScheduler::instance()->shutdown();
+        return result;
+    }
+
     QApplication app(argc, argv);
     QGuiApplication::setApplicationDisplayName(ImageViewer::tr("Image Viewer"));
     QCommandLineParser commandLineParser;
     commandLineParser.addHelpOption();
     commandLineParser.addPositionalArgument(ImageViewer::tr("[file]"), ImageViewer::tr("Image file to open."));
+    QCommandLineOption listenOption("listen",
+        ImageViewer::tr("Accept JSON-lines control commands on local socket <name>."),
+        ImageViewer::tr("name"));
+    commandLineParser.addOption(listenOption);
+    QCommandLineOption startupTimeOption("startup-time",
+        ImageViewer::tr("Print how long the window, the restored image and the revalidated file list take."));
+    commandLineParser.addOption(startupTimeOption);
     commandLineParser.process(QCoreApplication::arguments());
     ImageViewer imageViewer;
     if (!commandLineParser.positionalArguments().isEmpty()
         && !imageViewer.loadFile(commandLineParser.positionalArguments().front())) {
         return -1;
     }
+    ControlServer controlServer(&imageViewer);
+    if (commandLineParser.isSet(listenOption) && !controlServer.listen(commandLineParser.value(listenOption)))
+        qWarning("Cannot listen on %s: %s", qPrintable(commandLineParser.value(listenOption)),
+                 qPrintable(controlServer.errorString()));
     imageViewer.show();
     QObject::connect(&app, SIGNAL(aboutToQuit()), &imageViewer, SLOT(saveExit()));
+    if (commandLineParser.isSet(startupTimeOption)) {
+        QTimer::singleShot(0, &imageViewer, [&startup]() {
+            QTextStream(stderr) << "startup: window shown after " << startup.elapsed() << " ms\n";
+        });
+        QObject::connect(&imageViewer, &ImageViewer::sessionRestored, [&startup]() {
+            QTextStream(stderr) << "startup: session restored after " << startup.elapsed() << " ms\n";
+        });
+        QObject::connect(&imageViewer, &ImageViewer::sessionRevalidated, [&startup]() {
+            QTextStream(stderr) << "startup: file list revalidated after " << startup.elapsed() << " ms\n";
+        });
+    }
+    // An image named on the command line takes the place of the last session.
+    if (commandLineParser.positionalArguments().isEmpty())
+        QTimer::singleShot(0, &imageViewer, &ImageViewer::restoreSession);
     //imageViewer.showMaximized();
-    return app.exec();
+    int result = app.exec();
+    imageViewer.cancelJobs();
+    TaskScheduler::instance()->shutdown();
+    return result;
 }
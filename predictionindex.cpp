@@ -0,0 +1,167 @@
+#include "predictionindex.h"
+#include "annotationmodel.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QPointer>
+
+static QString baseName(const QByteArray &path)
+{
+    int slash = qMax(path.lastIndexOf('/'), path.lastIndexOf('\\'));
+    return QString::fromUtf8(path.mid(slash + 1));
+}
+
+PredictionIndex::PredictionIndex(QObject *parent)
+    : QObject(parent), json(false)
+{
+}
+
+PredictionIndex::~PredictionIndex()
+{
+    cancel();
+}
+
+void PredictionIndex::cancel()
+{
+    token.cancel();
+}
+
+bool PredictionIndex::isEmpty() const
+{
+    return runs.isEmpty();
+}
+
+// Pulls out the image name without parsing the rest of the line.
+QString PredictionIndex::imageKey(const QByteArray &line, bool json)
+{
+    if (!json) {
+        int comma = line.indexOf(',');
+        QByteArray image = line.left(comma < 0 ? line.size() : comma).trimmed();
+        if (image.startsWith('"') && image.endsWith('"') && image.size() >= 2)
+            image = image.mid(1, image.size() - 2);
+        return baseName(image);
+    }
+    int field = line.indexOf("\"image\"");
+    if (field < 0)
+        return QString();
+    int colon = line.indexOf(':', field + 7);
+    int open = colon < 0 ? -1 : line.indexOf('"', colon + 1);
+    int close = open < 0 ? -1 : line.indexOf('"', open + 1);
+    if (close < 0)
+        return QString();
+    return baseName(line.mid(open + 1, close - open - 1));
+}
+
+void PredictionIndex::open(const QString &name)
+{
+    token.cancel();
+    token = TaskScheduler::Token();
+    runs.clear();
+    fileName = name;
+
+    const TaskScheduler::Token token = this->token;
+    QPointer<PredictionIndex> self(this);
+    TaskScheduler::instance()->submit(TaskScheduler::Background, [=]() {
+        QFile file(name);
+        Index index;
+        qint64 count = 0;
+        bool json = false;
+        if (file.open(QIODevice::ReadOnly)) {
+            const qint64 total = file.size();
+            bool first = true;
+            QString lastKey;
+            Run *run = 0;
+            while (!file.atEnd()) {
+                if (token.isCancelled())
+                    return;
+                const qint64 offset = file.pos();
+                const QByteArray line = file.readLine().trimmed();
+                if (line.isEmpty())
+                    continue;
+                if (first) {
+                    json = line.startsWith('{');
+                    first = false;
+                }
+                const QString key = imageKey(line, json);
+                if (key.isEmpty())
+                    continue;
+                if (!run || key != lastKey) {
+                    QVector<Run> &imageRuns = index[key];
+                    Run next = { offset, offset };
+                    imageRuns.append(next);
+                    run = &imageRuns.last();
+                    lastKey = key;
+                }
+                run->end = file.pos();
+                if ((++count & 0xffff) == 0) {
+                    const qint64 bytes = file.pos();
+                    TaskScheduler::runOnMain(self, [=]() {
+                        if (!token.isCancelled())
+                            emit self->progress(bytes, total);
+                    });
+                }
+            }
+        }
+        TaskScheduler::runOnMain(self, [=]() {
+            if (token.isCancelled())
+                return;
+            self->json = json;
+            self->runs = index;
+            emit self->indexed(index.size(), count);
+        });
+    }, token);
+}
+
+int PredictionIndex::load(const QString &imageFile, AnnotationModel *boxes, QVector<float> *scores,
+                          ClassTable *classes) const
+{
+    Index::const_iterator it = runs.constFind(QFileInfo(imageFile).fileName());
+    if (it == runs.constEnd())
+        return 0;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    int loaded = 0;
+    foreach (const Run &run, it.value()) {
+        if (!file.seek(run.offset))
+            continue;
+        while (file.pos() < run.end && !file.atEnd()) {
+            const QByteArray line = file.readLine().trimmed();
+            QString className;
+            float score = 0;
+            QPoint corners[4];
+            bool ok = false;
+            if (json) {
+                const QJsonObject object = QJsonDocument::fromJson(line).object();
+                const QJsonArray points = object.value("points").toArray();
+                ok = points.size() == 8 && object.value("score").isDouble();
+                if (ok) {
+                    className = object.value("class").toString();
+                    score = float(object.value("score").toDouble());
+                    for (int j = 0; j < 4; j++)
+                        corners[j] = QPoint(qRound(points[2 * j].toDouble()), qRound(points[2 * j + 1].toDouble()));
+                }
+            } else {
+                const QList<QByteArray> fields = line.split(',');
+                if (fields.size() >= 11) {
+                    score = fields[2].trimmed().toFloat(&ok);
+                    className = QString::fromUtf8(fields[1].trimmed());
+                    for (int j = 0; j < 4; j++)
+                        corners[j] = QPoint(qRound(fields[3 + 2 * j].trimmed().toDouble()),
+                                            qRound(fields[4 + 2 * j].trimmed().toDouble()));
+                }
+            }
+            if (!ok)
+                continue;
+            boxes->append(corners, classes->intern(className), AnnotationModel::Predicted);
+            scores->append(score);
+            loaded++;
+        }
+    }
+    return loaded;
+}
@@ -0,0 +1,52 @@
+#ifndef PREDICTIONINDEX_H
+#define PREDICTIONINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "taskscheduler.h"
+
+class AnnotationModel;
+class ClassTable;
+
+// Indexes a large file of scored model predictions without loading it. Only
+// the byte offsets of each image's lines are kept; the boxes themselves are
+// parsed when that image is shown. Two formats are accepted, one box per line:
+//   CSV:        image,class,score,x0,y0,x1,y1,x2,y2,x3,y3
+//   JSON lines: {"image":"a.jpg","class":"car","score":0.9,"points":[x0,y0,...,y3]}
+// Images are matched by file name, like the label files.
+class PredictionIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PredictionIndex(QObject *parent = 0);
+    ~PredictionIndex();
+
+    void open(const QString &fileName);
+    void cancel();
+    bool isEmpty() const;
+    int load(const QString &imageFile, AnnotationModel *boxes, QVector<float> *scores, ClassTable *classes) const;
+
+signals:
+    void progress(qint64 bytes, qint64 total);
+    void indexed(int images, qint64 predictions);
+
+private:
+    // Byte range of consecutive lines that belong to the same image.
+    struct Run {
+        qint64 offset;
+        qint64 end;
+    };
+    typedef QHash<QString, QVector<Run> > Index;
+
+    static QString imageKey(const QByteArray &line, bool json);
+
+    TaskScheduler::Token token;
+    QString fileName;
+    bool json;
+    Index runs;
+};
+
+#endif // PREDICTIONINDEX_H
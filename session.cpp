@@ -0,0 +1,65 @@
+#include "session.h"
+#include "fileindex.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static const quint32 sessionMagic = 0x53535649;   // "IVSS" in little endian
+static const quint32 sessionVersion = 1;
+
+Session::Session()
+    : selectedFile(-1), scaleFactor(1.0), fitToWindow(false)
+{
+}
+
+// Written through QSaveFile so a crash while quitting never leaves half a session.
+bool Session::save(const QString &fileName) const
+{
+    QDir().mkpath(QFileInfo(fileName).path());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << sessionMagic << sessionVersion;
+    out << directory << pattern << image << qint32(selectedFile) << scaleFactor << fitToWindow << scroll;
+    out << bool(files);
+    if (files)
+        files->save(out);
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool Session::load(const QString &fileName, bool withFiles)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    quint32 version;
+    in >> magic >> version;
+    if (magic != sessionMagic || version != sessionVersion)
+        return false;
+    qint32 selected;
+    bool hasFiles;
+    in >> directory >> pattern >> image >> selected >> scaleFactor >> fitToWindow >> scroll >> hasFiles;
+    selectedFile = selected;
+    if (in.status() != QDataStream::Ok)
+        return false;
+    files.clear();
+    if (withFiles && hasFiles)
+        files = FileIndex::load(in);
+    return true;
+}
+
+QString Session::defaultFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/session.ivs";
+}
@@ -0,0 +1,32 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QPoint>
+#include <QSharedPointer>
+#include <QString>
+
+class FileIndex;
+
+// Where the viewer was left: the last scan, the image on screen and how it
+// was zoomed and scrolled. Written on exit, read back on the next start.
+struct Session
+{
+    Session();
+
+    QString directory;
+    QString pattern;
+    QSharedPointer<const FileIndex> files;
+    QString image;
+    int selectedFile;
+    double scaleFactor;
+    bool fitToWindow;
+    QPoint scroll;
+
+    bool save(const QString &fileName) const;
+    // Without files only the header is read, which is fast at any list size.
+    bool load(const QString &fileName, bool withFiles = true);
+
+    static QString defaultFileName();
+};
+
+#endif // SESSION_H
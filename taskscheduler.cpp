@@ -0,0 +1,236 @@
+#include "taskscheduler.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+
+namespace {
+
+class MainThreadEvent : public QEvent
+{
+public:
+    MainThreadEvent(QObject *context, const TaskScheduler::Task &task)
+        : QEvent(eventType()), context(context), hasContext(context != 0), task(task) {}
+
+    static QEvent::Type eventType()
+    {
+        static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+        return type;
+    }
+
+    QPointer<QObject> context;
+    bool hasContext;
+    TaskScheduler::Task task;
+};
+
+class Dispatcher : public QObject
+{
+public:
+    Dispatcher()
+    {
+        if (QCoreApplication::instance())
+            moveToThread(QCoreApplication::instance()->thread());
+    }
+
+protected:
+    bool event(QEvent *event)
+    {
+        if (event->type() != MainThreadEvent::eventType())
+            return QObject::event(event);
+        MainThreadEvent *call = static_cast<MainThreadEvent *>(event);
+        if (!call->hasContext || call->context)
+            call->task();
+        return true;
+    }
+};
+
+thread_local TaskScheduler *currentScheduler = 0;
+thread_local int currentWorker = -1;
+
+}
+
+Q_GLOBAL_STATIC(TaskScheduler, globalScheduler)
+Q_GLOBAL_STATIC(Dispatcher, globalDispatcher)
+
+TaskScheduler::Token::Token()
+    : cancelled(new QAtomicInt(0))
+{
+}
+
+bool TaskScheduler::Token::isCancelled() const
+{
+    return cancelled->load() != 0;
+}
+
+void TaskScheduler::Token::cancel()
+{
+    cancelled->store(1);
+}
+
+TaskScheduler *TaskScheduler::instance()
+{
+    return globalScheduler();
+}
+
+TaskScheduler::TaskScheduler(int threads)
+    : pending(0), stopping(0), nextWorker(0)
+{
+    if (threads <= 0)
+        threads = qMax(1, QThread::idealThreadCount());
+    for (int i = 0; i < threads; i++)
+        workers.push_back(new Worker);
+    for (int i = 0; i < threads; i++)
+        workers[i]->thread = std::thread(&TaskScheduler::run, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    shutdown();
+}
+
+int TaskScheduler::threadCount() const
+{
+    return int(workers.size());
+}
+
+void TaskScheduler::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        if (stopping.loadAcquire())
+            return;
+        stopping.storeRelease(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(tokensMutex);
+        for (QHash<QString, Token>::iterator it = tokens.begin(); it != tokens.end(); ++it)
+            it.value().cancel();
+        tokens.clear();
+    }
+    wakeUp.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i]->thread.join();
+    for (size_t i = 0; i < workers.size(); i++)
+        delete workers[i];
+    workers.clear();
+}
+
+void TaskScheduler::submit(Priority priority, const Task &task, const Token &token)
+{
+    if (workers.empty())
+        return;
+    Entry entry;
+    entry.task = task;
+    entry.token = token;
+    // Work spawned by a worker stays local; everything else is spread out.
+    int index = currentScheduler == this ? currentWorker
+                                         : int(unsigned(nextWorker.fetchAndAddRelaxed(1)) % workers.size());
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->queues[priority].push_back(std::move(entry));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pending++;
+    }
+    wakeUp.notify_one();
+}
+
+void TaskScheduler::parallelFor(Priority priority, int count, const std::function<void(int)> &body,
+                                const Token &token, const Task &done)
+{
+    if (count <= 0) {
+        submit(priority, done);
+        return;
+    }
+    QSharedPointer<QAtomicInt> remaining(new QAtomicInt(count));
+    for (int i = 0; i < count; i++) {
+        submit(priority, [=]() {
+            if (!token.isCancelled())
+                body(i);
+            if (!remaining->deref())
+                done();
+        });
+    }
+}
+
+TaskScheduler::Token TaskScheduler::token(const QString &key)
+{
+    std::lock_guard<std::mutex> lock(tokensMutex);
+    QHash<QString, Token>::iterator it = tokens.find(key);
+    if (it == tokens.end())
+        it = tokens.insert(key, Token());
+    return it.value();
+}
+
+void TaskScheduler::cancel(const QString &key)
+{
+    std::lock_guard<std::mutex> lock(tokensMutex);
+    QHash<QString, Token>::iterator it = tokens.find(key);
+    if (it == tokens.end())
+        return;
+    it.value().cancel();
+    tokens.erase(it);
+}
+
+void TaskScheduler::runOnMain(QObject *context, const Task &task)
+{
+    QCoreApplication::postEvent(globalDispatcher(), new MainThreadEvent(context, task));
+}
+
+void TaskScheduler::postProgress(QObject *context, const Token &token, int done, int total,
+                                 const std::function<void(int, int)> &report)
+{
+    if (done % 64 != 0 && done != total)
+        return;
+    runOnMain(context, [=]() {
+        if (!token.isCancelled())
+            report(done, total);
+    });
+}
+
+void TaskScheduler::run(int index)
+{
+    currentScheduler = this;
+    currentWorker = index;
+    for (;;) {
+        if (stopping.loadAcquire())
+            return;
+        Entry entry;
+        if (take(index, &entry)) {
+            if (!entry.token.isCancelled())
+                entry.task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return stopping.loadAcquire() || pending > 0; });
+    }
+}
+
+bool TaskScheduler::take(int index, Entry *entry)
+{
+    const size_t count = workers.size();
+    for (int priority = 0; priority < PriorityCount; priority++) {
+        for (size_t k = 0; k < count; k++) {
+            Worker *worker = workers[(index + k) % count];
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            std::deque<Entry> &queue = worker->queues[priority];
+            if (queue.empty())
+                continue;
+            if (k == 0) {
+                *entry = std::move(queue.back());
+                queue.pop_back();
+            } else {
+                *entry = std::move(queue.front());
+                queue.pop_front();
+            }
+            lock.unlock();
+            std::lock_guard<std::mutex> sleepLock(sleepMutex);
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,95 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QObject;
+
+// Application-wide pool for all background work. Every worker owns one deque
+// per priority: it pops its own work LIFO and steals from the others FIFO,
+// always preferring higher priorities over its own lower-priority work.
+class TaskScheduler
+{
+public:
+    enum Priority {
+        Visible,     // the image on screen
+        Prefetch,    // images likely to be shown next
+        Background,  // indexing, hashing, exports
+        PriorityCount
+    };
+
+    typedef std::function<void()> Task;
+
+    // Shared cancellation flag. Tasks submitted with a cancelled token are
+    // dropped before they start; long-running tasks should poll it.
+    class Token
+    {
+    public:
+        Token();
+        bool isCancelled() const;
+        void cancel();
+    private:
+        QSharedPointer<QAtomicInt> cancelled;
+    };
+
+    static TaskScheduler *instance();
+
+    explicit TaskScheduler(int threads = 0);
+    ~TaskScheduler();
+
+    int threadCount() const;
+    void submit(Priority priority, const Task &task, const Token &token = Token());
+    // Runs body(0..count-1) as separate tasks, then done() once on a worker.
+    void parallelFor(Priority priority, int count, const std::function<void(int)> &body,
+                     const Token &token, const Task &done);
+    // Cancels every keyed token, then stops the workers. Queued tasks are
+    // discarded, so a parallelFor's done() may never run; running tasks
+    // finish at their next cancellation check.
+    void shutdown();
+
+    // Tokens tied to a key such as the current directory or selection.
+    Token token(const QString &key);
+    void cancel(const QString &key);
+
+    // Queues task on the main thread; it is skipped if context is destroyed.
+    static void runOnMain(QObject *context, const Task &task);
+    // Progress of a parallelFor: report(done, total) runs on the main thread
+    // for every 64th item and the last one, unless token is cancelled by then.
+    static void postProgress(QObject *context, const Token &token, int done, int total,
+                             const std::function<void(int, int)> &report);
+
+private:
+    struct Entry {
+        Task task;
+        Token token;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Entry> queues[PriorityCount];
+        std::thread thread;
+    };
+
+    void run(int index);
+    bool take(int index, Entry *entry);
+
+    std::vector<Worker *> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    int pending;
+    QAtomicInt stopping;    // read by workers before taking each task
+    QAtomicInt nextWorker;
+
+    std::mutex tokensMutex;
+    QHash<QString, Token> tokens;
+};
+
+#endif // TASKSCHEDULER_H